@@ -1,12 +1,12 @@
 option(CMOPT_DEBUG         "Include additional debug-code in core" OFF)
 option(CMOPT_WARNINGS      "Show all warnings during compile"      OFF)
 option(CMOPT_PCH           "Use precompiled headers"               ON)
+option(CMOPT_TOOLS         "Build tools"                           OFF)
 
 # TODO: options that should be checked/created:
 #option(CLI                  "With CLI"                              ON)
 #option(RA                   "With Remote Access"                    OFF)
 #option(SQL                  "Copy SQL files"                        OFF)
-#option(TOOLS                "Build tools"                           OFF)
 
 message("")
 message(STATUS
@@ -16,6 +16,7 @@ message(STATUS
     CMOPT_PCH               Use precompiled headers
     CMOPT_DEBUG             Include additional debug-code in core
     CMOPT_WARNINGS          Show all warnings during compile
+    CMOPT_TOOLS             Build tools (load generator)
 
   To set an option simply type -D<OPTION>=<VALUE> after 'cmake <srcs>'.
   Also, you can specify the generator with -G. see 'cmake --help' for more details
@@ -42,10 +42,10 @@ endif()
 #   message(STATUS "Install SQL-files     : No  (default)")
 # endif()
 
-# if(TOOLS)
-#   message(STATUS "Build map/vmap tools  : Yes")
-# else()
-#   message(STATUS "Build map/vmap tools  : No  (default)")
-# endif()
+if(CMOPT_TOOLS)
+  message(STATUS "Build tools           : Yes")
+else()
+  message(STATUS "Build tools           : No  (default)")
+endif()
 
 message("")
@@ -17,19 +17,23 @@
  */
 
 #include "Auth/BigNumber.h"
+#include "Auth/SecureRandom.h"
 #include <openssl/bn.h>
+#include <openssl/crypto.h>
 #include <algorithm>
 
 BigNumber::BigNumber()
 {
     _bn = BN_new();
     _array = nullptr;
+    _arraySize = 0;
 }
 
 BigNumber::BigNumber(const BigNumber& bn)
 {
     _bn = BN_dup(bn._bn);
     _array = nullptr;
+    _arraySize = 0;
 }
 
 BigNumber::BigNumber(uint32 val)
@@ -37,6 +41,7 @@ BigNumber::BigNumber(uint32 val)
     _bn = BN_new();
     BN_set_word(_bn, val);
     _array = nullptr;
+    _arraySize = 0;
 }
 
 BigNumber::~BigNumber()
@@ -45,6 +50,24 @@ BigNumber::~BigNumber()
     if (_array) delete[] _array;
 }
 
+namespace
+{
+    // frees the context when its thread ends
+    struct ThreadContextHolder
+    {
+        BN_CTX* context;
+
+        ThreadContextHolder() : context(BN_CTX_new()) {}
+        ~ThreadContextHolder() { BN_CTX_free(context); }
+    };
+}
+
+BN_CTX* BigNumber::ThreadContext()
+{
+    static thread_local ThreadContextHolder holder;
+    return holder.context;
+}
+
 void BigNumber::SetDword(uint32 val)
 {
     BN_set_word(_bn, val);
@@ -72,7 +95,23 @@ void BigNumber::SetHexStr(const char* str)
 
 void BigNumber::SetRand(int numbits)
 {
-    BN_rand(_bn, numbits, 0, 1);
+    uint8 bytes[128];
+    const int size = (numbits + 7) / 8;
+
+    if (numbits <= 0 || size > int(sizeof(bytes)))
+    {
+        BN_rand(_bn, numbits, 0, 1);
+        return;
+    }
+
+    // same shape as BN_rand(top = 0, bottom = 1): exactly numbits long and odd
+    SecureRandom::Fill(bytes, size);
+    bytes[0] &= uint8(0xFF >> (size * 8 - numbits));
+    bytes[0] |= uint8(1 << ((numbits - 1) % 8));
+    bytes[size - 1] |= 1;
+
+    BN_bin2bn(bytes, size, _bn);
+    OPENSSL_cleanse(bytes, size);
 }
 
 BigNumber BigNumber::operator=(const BigNumber& bn)
@@ -95,58 +134,33 @@ BigNumber BigNumber::operator-=(const BigNumber& bn)
 
 BigNumber BigNumber::operator*=(const BigNumber& bn)
 {
-    BN_CTX* bnctx;
-
-    bnctx = BN_CTX_new();
-    BN_mul(_bn, _bn, bn._bn, bnctx);
-    BN_CTX_free(bnctx);
-
+    BN_mul(_bn, _bn, bn._bn, ThreadContext());
     return *this;
 }
 
 BigNumber BigNumber::operator/=(const BigNumber& bn)
 {
-    BN_CTX* bnctx;
-
-    bnctx = BN_CTX_new();
-    BN_div(_bn, nullptr, _bn, bn._bn, bnctx);
-    BN_CTX_free(bnctx);
-
+    BN_div(_bn, nullptr, _bn, bn._bn, ThreadContext());
     return *this;
 }
 
 BigNumber BigNumber::operator%=(const BigNumber& bn)
 {
-    BN_CTX* bnctx;
-
-    bnctx = BN_CTX_new();
-    BN_mod(_bn, _bn, bn._bn, bnctx);
-    BN_CTX_free(bnctx);
-
+    BN_mod(_bn, _bn, bn._bn, ThreadContext());
     return *this;
 }
 
 BigNumber BigNumber::Exp(const BigNumber& bn)
 {
     BigNumber ret;
-    BN_CTX* bnctx;
-
-    bnctx = BN_CTX_new();
-    BN_exp(ret._bn, _bn, bn._bn, bnctx);
-    BN_CTX_free(bnctx);
-
+    BN_exp(ret._bn, _bn, bn._bn, ThreadContext());
     return ret;
 }
 
 BigNumber BigNumber::ModExp(const BigNumber& bn1, const BigNumber& bn2)
 {
     BigNumber ret;
-    BN_CTX* bnctx;
-
-    bnctx = BN_CTX_new();
-    BN_mod_exp(ret._bn, _bn, bn1._bn, bn2._bn, bnctx);
-    BN_CTX_free(bnctx);
-
+    BN_mod_exp(ret._bn, _bn, bn1._bn, bn2._bn, ThreadContext());
     return ret;
 }
 
@@ -169,18 +183,71 @@ uint8* BigNumber::AsByteArray(int minSize)
 {
     int length = (minSize >= GetNumBytes()) ? minSize : GetNumBytes();
 
-    delete[] _array;
-    _array = new uint8[length];
+    // the array is kept for the next call, it only grows
+    if (length > _arraySize)
+    {
+        delete[] _array;
+        _array = new uint8[length];
+        _arraySize = length;
+    }
+
+    WriteBytes(_array, length);
+
+    return _array;
+}
+
+bool BigNumber::WriteBytes(uint8* buffer, int size, bool bigEndian) const
+{
+    const int numBytes = GetNumBytes();
+    if (numBytes > size)
+        return false;
 
-    // If we need more bytes than length of BigNumber set the rest to 0
-    if (length > GetNumBytes())
-        memset((void*)_array, 0, length);
+    // the big endian value ends at the last byte, leading bytes are zero
+    memset(buffer, 0, size - numBytes);
+    BN_bn2bin(_bn, buffer + (size - numBytes));
 
-    BN_bn2bin(_bn, (unsigned char*)_array);
+    if (!bigEndian)
+        std::reverse(buffer, buffer + size);
 
-    std::reverse(_array, _array + length);
+    return true;
+}
 
-    return _array;
+bool BigNumber::WriteHexStr(char* buffer, int size) const
+{
+    static const char digits[] = "0123456789ABCDEF";
+
+    if (BN_is_zero(_bn))
+    {
+        if (size < 2)
+            return false;
+
+        buffer[0] = '0';
+        buffer[1] = '\0';
+        return true;
+    }
+
+    const int negative = BN_is_negative(_bn) ? 1 : 0;
+    const int numBytes = GetNumBytes();
+    if (size < negative + numBytes * 2 + 1)
+        return false;
+
+    // the digits go to the end of the buffer first, they are then moved behind the sign
+    uint8* bytes = reinterpret_cast<uint8*>(buffer + size - numBytes);
+    BN_bn2bin(_bn, bytes);
+
+    char* out = buffer;
+    if (negative)
+        *out++ = '-';
+
+    for (int i = 0; i < numBytes; ++i)
+    {
+        const uint8 byte = bytes[i];
+        *out++ = digits[byte >> 4];
+        *out++ = digits[byte & 0x0F];
+    }
+    *out = '\0';
+
+    return true;
 }
 
 const char* BigNumber::AsHexStr() const
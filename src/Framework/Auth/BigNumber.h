@@ -22,6 +22,7 @@
 #include "Common.h"
 
 struct bignum_st;
+struct bignum_ctx;
 
 class BigNumber
 {
@@ -79,15 +80,26 @@ class BigNumber
         int GetNumBytes(void) const;
 
         struct bignum_st* BN() { return _bn; }
+        struct bignum_st const* BN() const { return _bn; }
+
+        /// Scratch space of the calling thread for OpenSSL operations, created on first use
+        static struct bignum_ctx* ThreadContext();
 
         uint32 AsDword() const;
         uint8* AsByteArray(int minSize = 0);
 
+        /// Writes exactly size bytes, zero padded, little endian unless bigEndian.
+        /// Nothing is written and false is returned when the number needs more bytes.
+        bool WriteBytes(uint8* buffer, int size, bool bigEndian = false) const;
+        /// Writes the same text as AsHexStr() with its terminating zero, false if size is too small
+        bool WriteHexStr(char* buffer, int size) const;
+
         const char* AsHexStr() const;
         const char* AsDecStr() const;
 
     private:
         struct bignum_st* _bn;
         uint8* _array;
+        int _arraySize;
 };
 #endif
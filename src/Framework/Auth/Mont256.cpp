@@ -0,0 +1,192 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "Auth/Mont256.h"
+
+#include <assert.h>
+
+namespace
+{
+    // all ones when value is zero, else zero
+    inline Mont256::Limb ZeroMask(Mont256::Limb value)
+    {
+        return ((value | (Mont256::Limb(0) - value)) >> (Mont256::LimbBits - 1)) - 1;
+    }
+}
+
+Mont256::Mont256(uint8 const* modulus)
+{
+    for (int i = 0; i < Limbs; ++i)
+    {
+        m_modulus[i] = 0;
+        for (int j = sizeof(Limb) - 1; j >= 0; --j)
+            m_modulus[i] = (m_modulus[i] << 8) | modulus[i * sizeof(Limb) + j];
+    }
+
+    // a single subtraction has to reduce any value below 2^256
+    assert((m_modulus[0] & 1) && (m_modulus[Limbs - 1] >> (LimbBits - 1)));
+
+    // Newton iteration, every step doubles the correct low bits
+    Limb inverse = 1;
+    for (int i = 0; i < 7; ++i)
+        inverse *= 2 - m_modulus[0] * inverse;
+    m_n0 = Limb(0) - inverse;
+
+    // R mod N = 2^256 - N
+    Limb borrow = 0;
+    for (int i = 0; i < Limbs; ++i)
+    {
+        const WideLimb d = WideLimb(0) - m_modulus[i] - borrow;
+        m_one.limb[i] = Limb(d);
+        borrow = Limb(d >> LimbBits) & 1;
+    }
+
+    // R^2 mod N by doubling R another 256 times
+    m_rr = m_one;
+    for (int i = 0; i < Bytes * 8; ++i)
+        Add(m_rr, m_rr, m_rr);
+}
+
+void Mont256::ReduceOnce(Limb* r, Limb const* a, Limb carry) const
+{
+    Number d;
+    Limb borrow = 0;
+    for (int i = 0; i < Limbs; ++i)
+    {
+        const WideLimb diff = WideLimb(a[i]) - m_modulus[i] - borrow;
+        d[i] = Limb(diff);
+        borrow = Limb(diff >> LimbBits) & 1;
+    }
+
+    // keep the difference when a carried out or did not borrow
+    const Limb mask = ~ZeroMask(carry | (borrow ^ 1));
+    for (int i = 0; i < Limbs; ++i)
+        r[i] = (d[i] & mask) | (a[i] & ~mask);
+}
+
+bool Mont256::FromBytes(Element& r, uint8 const* bytes, int len) const
+{
+    if (len < 0 || len > Bytes)
+        return false;
+
+    Element value = {};
+    for (int i = 0; i < len; ++i)
+        value.limb[i / sizeof(Limb)] |= Limb(bytes[i]) << (8 * (i % sizeof(Limb)));
+
+    ReduceOnce(value.limb, value.limb, 0);
+    Mul(r, value, m_rr);
+    return true;
+}
+
+void Mont256::ToBytes(uint8* bytes, Element const& a) const
+{
+    Element one = {};
+    one.limb[0] = 1;
+
+    Element value;
+    Mul(value, a, one);
+
+    for (int i = 0; i < Bytes; ++i)
+        bytes[i] = uint8(value.limb[i / sizeof(Limb)] >> (8 * (i % sizeof(Limb))));
+}
+
+bool Mont256::IsZero(Element const& a) const
+{
+    Limb bits = 0;
+    for (int i = 0; i < Limbs; ++i)
+        bits |= a.limb[i];
+
+    return !bits;
+}
+
+void Mont256::Add(Element& r, Element const& a, Element const& b) const
+{
+    Number sum;
+    WideLimb carry = 0;
+    for (int i = 0; i < Limbs; ++i)
+    {
+        carry = WideLimb(a.limb[i]) + b.limb[i] + (carry >> LimbBits);
+        sum[i] = Limb(carry);
+    }
+
+    ReduceOnce(r.limb, sum, Limb(carry >> LimbBits));
+}
+
+/// Coarsely integrated operand scanning, r = a * b / R mod N
+void Mont256::Mul(Element& r, Element const& a, Element const& b) const
+{
+    Limb t[Limbs + 2] = {};
+
+    for (int i = 0; i < Limbs; ++i)
+    {
+        WideLimb c = 0;
+        for (int j = 0; j < Limbs; ++j)
+        {
+            c = WideLimb(a.limb[j]) * b.limb[i] + t[j] + (c >> LimbBits);
+            t[j] = Limb(c);
+        }
+        c = WideLimb(t[Limbs]) + (c >> LimbBits);
+        t[Limbs] = Limb(c);
+        t[Limbs + 1] = Limb(c >> LimbBits);
+
+        const Limb m = t[0] * m_n0;
+        c = WideLimb(m) * m_modulus[0] + t[0];
+        for (int j = 1; j < Limbs; ++j)
+        {
+            c = WideLimb(m) * m_modulus[j] + t[j] + (c >> LimbBits);
+            t[j - 1] = Limb(c);
+        }
+        c = WideLimb(t[Limbs]) + (c >> LimbBits);
+        t[Limbs - 1] = Limb(c);
+        t[Limbs] = t[Limbs + 1] + Limb(c >> LimbBits);
+    }
+
+    ReduceOnce(r.limb, t, t[Limbs]);
+}
+
+/// Fixed 4 bit window; every window squares four times and multiplies by an entry read
+/// with a full scan of the table, so neither depends on the exponent bits
+void Mont256::ModExp(Element& r, Element const& base, uint8 const* exponent, int len) const
+{
+    Element table[16];
+    table[0] = m_one;
+    table[1] = base;
+    for (int i = 2; i < 16; ++i)
+        Mul(table[i], table[i - 1], base);
+
+    r = m_one;
+
+    for (int nibble = len * 2 - 1; nibble >= 0; --nibble)
+    {
+        if (nibble != len * 2 - 1)
+            for (int i = 0; i < 4; ++i)
+                Mul(r, r, r);
+
+        const Limb digit = (exponent[nibble / 2] >> ((nibble & 1) * 4)) & 0xF;
+
+        Element entry = {};
+        for (int i = 0; i < 16; ++i)
+        {
+            const Limb mask = ZeroMask(Limb(i) ^ digit);
+            for (int j = 0; j < Limbs; ++j)
+                entry.limb[j] |= table[i].limb[j] & mask;
+        }
+
+        Mul(r, r, entry);
+    }
+}
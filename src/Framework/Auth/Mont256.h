@@ -0,0 +1,76 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _AUTH_MONT256_H
+#define _AUTH_MONT256_H
+
+#include "Common.h"
+
+/// Montgomery arithmetic modulo a fixed 256 bit odd modulus whose top bit is set, as the
+/// SRP6 N is. Numbers are fixed size limb arrays living on the stack, nothing allocates
+/// after construction. Mul, Add and ModExp run in constant time for a given exponent length.
+///
+/// Byte arrays are little endian, like BigNumber::AsByteArray and the packets.
+class Mont256
+{
+    public:
+#if defined(__SIZEOF_INT128__)
+        typedef uint64 Limb;
+        __extension__ typedef unsigned __int128 WideLimb;
+#else
+        typedef uint32 Limb;
+        typedef uint64 WideLimb;
+#endif
+
+        static const int Bytes = 32;
+        static const int LimbBits = sizeof(Limb) * 8;
+        static const int Limbs = Bytes / sizeof(Limb);
+
+        /// Residue in Montgomery form (x * 2^256 mod N)
+        struct Element
+        {
+            Limb limb[Limbs];
+        };
+
+        explicit Mont256(uint8 const* modulus);
+
+        /// Converts len <= Bytes bytes, reduced modulo N. False when the value does not fit.
+        bool FromBytes(Element& r, uint8 const* bytes, int len) const;
+        /// Writes Bytes bytes of the reduced value
+        void ToBytes(uint8* bytes, Element const& a) const;
+
+        void SetOne(Element& r) const { r = m_one; }
+        bool IsZero(Element const& a) const;
+
+        void Add(Element& r, Element const& a, Element const& b) const;
+        void Mul(Element& r, Element const& a, Element const& b) const;
+        /// r = base ^ exponent, exponent given as len little endian bytes
+        void ModExp(Element& r, Element const& base, uint8 const* exponent, int len) const;
+
+    private:
+        typedef Limb Number[Limbs];
+
+        // r = a - N when a >= N, with carry the bit above a
+        void ReduceOnce(Limb* r, Limb const* a, Limb carry) const;
+
+        Number m_modulus;
+        Limb m_n0;                                          ///< -N^-1 mod 2^LimbBits
+        Element m_one;                                      ///< R mod N
+        Element m_rr;                                       ///< R^2 mod N, converts into Montgomery form
+};
+#endif
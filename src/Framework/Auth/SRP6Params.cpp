@@ -0,0 +1,152 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "Auth/SRP6Params.h"
+#include "Auth/Sha1.h"
+
+#include <openssl/bn.h>
+
+SRP6Params const& SRP6Params::Instance()
+{
+    static SRP6Params instance;
+    return instance;
+}
+
+SRP6Params::SRP6Params() : m_k(3), m_mont(nullptr)
+{
+    m_N.SetHexStr("894B645E89E1535BBDAD5B8B290650530801B18EBFBF5E8FAB3C82872A3E9BB7");
+    m_g.SetDword(7);
+
+    m_N.WriteBytes(m_NBytes, NBytes);
+    m_g.WriteBytes(&m_gByte, 1);
+
+    m_mont256.reset(new Mont256(m_NBytes));
+
+    // t3 of the proof, hashed the same way UpdateBigNumbers does it
+    Sha1Hash sha;
+    sha.UpdateBigNumbers(&m_N, nullptr);
+    sha.Finalize();
+    uint8 hash[SHA_DIGEST_LENGTH];
+    memcpy(hash, sha.GetDigest(), SHA_DIGEST_LENGTH);
+
+    sha.Initialize();
+    sha.UpdateBigNumbers(&m_g, nullptr);
+    sha.Finalize();
+    for (int i = 0; i < SHA_DIGEST_LENGTH; ++i)
+        hash[i] ^= sha.GetDigest()[i];
+
+    BigNumber t3;
+    t3.SetBinary(hash, SHA_DIGEST_LENGTH);
+    m_NgHash.resize(t3.GetNumBytes());
+    t3.WriteBytes(&m_NgHash[0], t3.GetNumBytes());
+
+    // fixed-base table, each window starts at the 256th power of the previous one
+    BN_CTX* bnctx = BN_CTX_new();
+
+    m_mont = BN_MONT_CTX_new();
+    BN_MONT_CTX_set(m_mont, m_N.BN(), bnctx);
+
+    BIGNUM* base = BN_new();
+    BN_to_montgomery(base, m_g.BN(), m_mont, bnctx);
+
+    m_table.resize(Windows * WindowEntries);
+    for (int window = 0; window < Windows; ++window)
+    {
+        BIGNUM** entries = &m_table[window * WindowEntries];
+
+        entries[0] = BN_dup(base);
+        for (int digit = 1; digit < WindowEntries; ++digit)
+        {
+            entries[digit] = BN_new();
+            BN_mod_mul_montgomery(entries[digit], entries[digit - 1], base, m_mont, bnctx);
+        }
+
+        BN_mod_mul_montgomery(base, entries[WindowEntries - 1], base, m_mont, bnctx);
+    }
+
+    BN_free(base);
+    BN_CTX_free(bnctx);
+}
+
+SRP6Params::~SRP6Params()
+{
+    for (BIGNUM* entry : m_table)
+        BN_free(entry);
+
+    BN_MONT_CTX_free(m_mont);
+}
+
+BigNumber SRP6Params::ModExpG(BigNumber const& exponent) const
+{
+    const BIGNUM* e = exponent.BN();
+
+    if (BN_is_negative(e) || BN_num_bits(e) > TableBits)
+        return BigNumber(m_g).ModExp(exponent, m_N);
+
+    // big endian, window 0 is the last byte
+    uint8 digits[TableBits / 8] = {};
+    BN_bn2bin(e, digits + sizeof(digits) - BN_num_bytes(e));
+
+    BigNumber ret;
+    BN_CTX* bnctx = BigNumber::ThreadContext();
+    bool empty = true;
+
+    for (int window = 0; window < Windows; ++window)
+    {
+        const uint8 digit = digits[sizeof(digits) - 1 - window];
+        if (!digit)
+            continue;
+
+        BIGNUM const* entry = m_table[window * WindowEntries + digit - 1];
+        if (empty)
+            BN_copy(ret.BN(), entry);
+        else
+            BN_mod_mul_montgomery(ret.BN(), ret.BN(), entry, m_mont, bnctx);
+
+        empty = false;
+    }
+
+    if (empty)
+        ret.SetDword(1);                                    // g^0
+    else
+        BN_from_montgomery(ret.BN(), ret.BN(), m_mont, bnctx);
+
+    return ret;
+}
+
+void SRP6Params::MakeVerifier(std::string const& passHash, BigNumber& salt, BigNumber& verifier) const
+{
+    salt.SetRand(SaltBytes * 8);
+
+    BigNumber I;
+    I.SetHexStr(passHash.c_str());
+
+    // In case of leading zeros in the hash, restore them
+    uint8 mDigest[SHA_DIGEST_LENGTH];
+    if (!I.WriteBytes(mDigest, SHA_DIGEST_LENGTH, true))
+        memset(mDigest, 0, SHA_DIGEST_LENGTH);
+
+    Sha1Hash sha;
+    sha.UpdateBigNumbers(&salt, nullptr);
+    sha.UpdateData(mDigest, SHA_DIGEST_LENGTH);
+    sha.Finalize();
+
+    BigNumber x;
+    x.SetBinary(sha.GetDigest(), sha.GetLength());
+    verifier = ModExpG(x);
+}
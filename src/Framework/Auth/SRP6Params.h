@@ -0,0 +1,92 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _AUTH_SRP6PARAMS_H
+#define _AUTH_SRP6PARAMS_H
+
+#include "Common.h"
+#include "Auth/BigNumber.h"
+#include "Auth/Mont256.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+struct bn_mont_ctx_st;
+
+/// The SRP6 group used by the client (N, g, k) with the values derived from it.
+/// g^e mod N uses a fixed-base table: every byte of the exponent selects a precomputed
+/// power of g, so an exponent of up to TableBits bits costs one Montgomery multiplication
+/// per non zero byte instead of a full square and multiply exponentiation.
+class SRP6Params
+{
+    public:
+        static const int NBytes = 32;
+        static const int TableBits = 160;                   // b, a and x are at most SHA1 sized
+        static const int SaltBytes = 32;
+
+        static SRP6Params const& Instance();
+
+        SRP6Params();
+        ~SRP6Params();
+
+        BigNumber const& GetN() const { return m_N; }
+        BigNumber const& GetG() const { return m_g; }
+        BigNumber const& GetK() const { return m_k; }
+
+        /// N and g as sent in the logon challenge (little endian)
+        uint8 const* GetNBytes() const { return m_NBytes; }
+        uint8 GetGByte() const { return m_gByte; }
+
+        /// H(N) xor H(g) as hashed into the client proof M1
+        uint8 const* GetNgHash() const { return &m_NgHash[0]; }
+        int GetNgHashLength() const { return int(m_NgHash.size()); }
+
+        /// g^exponent mod N, through the table when the exponent fits in it
+        BigNumber ModExpG(BigNumber const& exponent) const;
+
+        /// New random salt s and verifier v = g^H(s, H(I:P)) for the hex ShaPassHash of an account
+        void MakeVerifier(std::string const& passHash, BigNumber& salt, BigNumber& verifier) const;
+
+        /// Allocation free, constant time arithmetic modulo N
+        Mont256 const& GetMont256() const { return *m_mont256; }
+
+    private:
+        SRP6Params(SRP6Params const&) = delete;
+        SRP6Params& operator=(SRP6Params const&) = delete;
+
+        static const int WindowBits = 8;
+        static const int Windows = TableBits / WindowBits;
+        static const int WindowEntries = (1 << WindowBits) - 1;
+
+        BigNumber m_N;
+        BigNumber m_g;
+        BigNumber m_k;
+
+        uint8 m_NBytes[NBytes];
+        uint8 m_gByte;
+        std::vector<uint8> m_NgHash;
+
+        std::unique_ptr<Mont256> m_mont256;
+
+        struct bn_mont_ctx_st* m_mont;
+        std::vector<struct bignum_st*> m_table;             ///< g^(d * 256^w) in Montgomery form, at [w * WindowEntries + d - 1]
+};
+
+#define sSRP6Params SRP6Params::Instance()
+#endif
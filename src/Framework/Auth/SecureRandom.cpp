@@ -0,0 +1,143 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "Auth/SecureRandom.h"
+
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    inline uint32 Rotate(uint32 value, int bits)
+    {
+        return (value << bits) | (value >> (32 - bits));
+    }
+
+    inline void QuarterRound(uint32* x, int a, int b, int c, int d)
+    {
+        x[a] += x[b]; x[d] = Rotate(x[d] ^ x[a], 16);
+        x[c] += x[d]; x[b] = Rotate(x[b] ^ x[c], 12);
+        x[a] += x[b]; x[d] = Rotate(x[d] ^ x[a], 8);
+        x[c] += x[d]; x[b] = Rotate(x[b] ^ x[c], 7);
+    }
+
+    /// One 64 byte ChaCha20 block (RFC 7539 layout, 64 bit counter and zero nonce)
+    void ChaChaBlock(uint32 const* key, uint64 counter, uint8* out)
+    {
+        uint32 state[16] =
+        {
+            0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+            key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7],
+            uint32(counter), uint32(counter >> 32), 0, 0
+        };
+
+        uint32 x[16];
+        memcpy(x, state, sizeof(x));
+
+        for (int i = 0; i < 10; ++i)
+        {
+            QuarterRound(x, 0, 4, 8, 12);
+            QuarterRound(x, 1, 5, 9, 13);
+            QuarterRound(x, 2, 6, 10, 14);
+            QuarterRound(x, 3, 7, 11, 15);
+            QuarterRound(x, 0, 5, 10, 15);
+            QuarterRound(x, 1, 6, 11, 12);
+            QuarterRound(x, 2, 7, 8, 13);
+            QuarterRound(x, 3, 4, 9, 14);
+        }
+
+        for (int i = 0; i < 16; ++i)
+        {
+            const uint32 word = x[i] + state[i];
+            out[i * 4 + 0] = uint8(word);
+            out[i * 4 + 1] = uint8(word >> 8);
+            out[i * 4 + 2] = uint8(word >> 16);
+            out[i * 4 + 3] = uint8(word >> 24);
+        }
+    }
+
+    struct Generator
+    {
+        static const size_t KeySize = 32;
+
+        uint32 key[KeySize / 4];
+        uint64 counter;
+        uint64 sinceSeed;
+
+        uint8 batch[SecureRandom::BatchSize];
+        size_t position;                                    // bytes of the batch already handed out
+
+        Generator() : counter(0), sinceSeed(SecureRandom::ReseedInterval), position(sizeof(batch)) {}
+
+        ~Generator()
+        {
+            OPENSSL_cleanse(key, sizeof(key));
+            OPENSSL_cleanse(batch, sizeof(batch));
+        }
+
+        void Refill()
+        {
+            if (sinceSeed >= SecureRandom::ReseedInterval)
+            {
+                // a generator which cannot be seeded must not hand out predictable keys
+                if (RAND_bytes(reinterpret_cast<unsigned char*>(key), KeySize) != 1)
+                    abort();
+
+                counter = 0;
+                sinceSeed = 0;
+            }
+
+            for (size_t i = 0; i < sizeof(batch) / 64; ++i)
+                ChaChaBlock(key, counter++, batch + i * 64);
+
+            // the first bytes are the next key and never handed out, earlier output cannot be recovered from the state
+            memcpy(key, batch, KeySize);
+            memset(batch, 0, KeySize);
+            position = KeySize;
+
+            sinceSeed += sizeof(batch);
+        }
+    };
+
+    thread_local Generator t_generator;
+}
+
+void SecureRandom::Fill(uint8* buffer, size_t size)
+{
+    Generator& generator = t_generator;
+
+    while (size)
+    {
+        if (generator.position == sizeof(generator.batch))
+            generator.Refill();
+
+        const size_t length = std::min(size, sizeof(generator.batch) - generator.position);
+
+        // handed out bytes are wiped right away
+        memcpy(buffer, generator.batch + generator.position, length);
+        memset(generator.batch + generator.position, 0, length);
+
+        generator.position += length;
+        buffer += length;
+        size -= length;
+    }
+}
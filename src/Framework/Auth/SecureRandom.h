@@ -0,0 +1,37 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _AUTH_SECURERANDOM_H
+#define _AUTH_SECURERANDOM_H
+
+#include "Common.h"
+
+/// Cryptographically secure random bytes without a lock shared between threads.
+/// Every thread runs its own ChaCha20 keystream seeded from OpenSSL, produced in batches
+/// of BatchSize bytes.  The start of every batch becomes the next key (fast key erasure),
+/// and the key is replaced by a fresh seed after ReseedInterval bytes.
+class SecureRandom
+{
+    public:
+        static const size_t BatchSize = 1024;
+        static const uint64 ReseedInterval = 1024 * 1024;
+
+        /// Fills size bytes from the calling thread's generator
+        static void Fill(uint8* buffer, size_t size);
+};
+#endif
@@ -46,11 +46,21 @@ void Sha1Hash::UpdateBigNumbers(BigNumber* bn0, ...)
     va_list v;
     BigNumber* bn;
 
+    // SRP6 values fit on the stack, larger ones go through the number's own array
+    uint8 bytes[64];
+
     va_start(v, bn0);
     bn = bn0;
     while (bn)
     {
-        UpdateData(bn->AsByteArray(), bn->GetNumBytes());
+        const int length = bn->GetNumBytes();
+        if (length <= int(sizeof(bytes)))
+        {
+            bn->WriteBytes(bytes, length);
+            UpdateData(bytes, length);
+        }
+        else
+            UpdateData(bn->AsByteArray(), length);
         bn = va_arg(v, BigNumber*);
     }
     va_end(v);
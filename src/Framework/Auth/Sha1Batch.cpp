@@ -0,0 +1,293 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "Auth/Sha1Batch.h"
+
+#include <cstring>
+
+#if defined(__GNUC__)
+#define SHA1BATCH_VECTORS
+#if defined(__x86_64__) || defined(__i386__)
+#define SHA1BATCH_AVX2
+#endif
+#endif
+
+namespace
+{
+    typedef void (*HashFunction)(uint8 const* const* messages, int const* lengths, int count, uint8* digests);
+
+    void HashScalar(uint8 const* const* messages, int const* lengths, int count, uint8* digests)
+    {
+        for (int i = 0; i < count; ++i)
+            SHA1(messages[i], lengths[i], digests + i * SHA_DIGEST_LENGTH);
+    }
+
+#ifdef SHA1BATCH_VECTORS
+    typedef uint32 Vector4 __attribute__((vector_size(16)));
+    typedef uint32 Vector8 __attribute__((vector_size(32)));
+
+    const uint32 InitialState[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+    // everything below is inlined into the function picking the instruction set, the vectors never cross a call
+
+#define SHA1BATCH_INLINE inline __attribute__((always_inline))
+#define SHA1BATCH_ROTATE(x, bits) (((x) << (bits)) | ((x) >> (32 - (bits))))
+
+#define SHA1BATCH_SCHEDULE(t) \
+    (w[(t) & 15] = SHA1BATCH_ROTATE(w[((t) - 3) & 15] ^ w[((t) - 8) & 15] ^ w[((t) - 14) & 15] ^ w[(t) & 15], 1))
+
+#define SHA1BATCH_ROUND(f, k, word)                                         \
+    {                                                                       \
+        V temp = SHA1BATCH_ROTATE(a, 5) + (f) + e + uint32(k) + (word);     \
+        e = d;                                                              \
+        d = c;                                                              \
+        c = SHA1BATCH_ROTATE(b, 30);                                        \
+        b = a;                                                              \
+        a = temp;                                                           \
+    }
+
+#define SHA1BATCH_WORD(t) ((t) < 16 ? w[(t) & 15] : SHA1BATCH_SCHEDULE(t))
+
+#define SHA1BATCH_ROUNDS5(t, f, k)                                          \
+    SHA1BATCH_ROUND(f, k, SHA1BATCH_WORD(t))                                \
+    SHA1BATCH_ROUND(f, k, SHA1BATCH_WORD((t) + 1))                          \
+    SHA1BATCH_ROUND(f, k, SHA1BATCH_WORD((t) + 2))                          \
+    SHA1BATCH_ROUND(f, k, SHA1BATCH_WORD((t) + 3))                          \
+    SHA1BATCH_ROUND(f, k, SHA1BATCH_WORD((t) + 4))
+
+#define SHA1BATCH_ROUNDS20(t, f, k)                                         \
+    SHA1BATCH_ROUNDS5(t, f, k)                                              \
+    SHA1BATCH_ROUNDS5((t) + 5, f, k)                                        \
+    SHA1BATCH_ROUNDS5((t) + 10, f, k)                                       \
+    SHA1BATCH_ROUNDS5((t) + 15, f, k)
+
+    /// 80 rounds over one block of every lane, w holds word t of all lanes in w[t]
+    template<class V>
+    SHA1BATCH_INLINE void Compress(V* state, V* w)
+    {
+        V a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+        // fully unrolled, the loop counter would otherwise keep the schedule in memory
+        SHA1BATCH_ROUNDS20(0, d ^ (b & (c ^ d)), 0x5A827999);
+        SHA1BATCH_ROUNDS20(20, b ^ c ^ d, 0x6ED9EBA1);
+        SHA1BATCH_ROUNDS20(40, (b & c) | (d & (b | c)), 0x8F1BBCDC);
+        SHA1BATCH_ROUNDS20(60, b ^ c ^ d, 0xCA62C1D6);
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+
+    /// count <= lanes messages of at most MaxLaneLength bytes
+    template<class V>
+    SHA1BATCH_INLINE void HashLanes(uint8 const* const* messages, int const* lengths, int count, uint8* digests)
+    {
+        const int lanes = sizeof(V) / sizeof(uint32);
+        const int maxBlocks = (Sha1Batch::MaxLaneLength + 9 + 63) / 64;
+
+        // padded messages, lanes without message keep no blocks
+        uint8 blocks[lanes][maxBlocks * 64];
+        int blockCount[lanes];
+        int longest = 0;
+
+        for (int lane = 0; lane < lanes; ++lane)
+        {
+            if (lane >= count)
+            {
+                blockCount[lane] = 0;
+                continue;
+            }
+
+            const int length = lengths[lane];
+            const int padded = (length + 9 + 63) / 64 * 64;
+            const uint64 bits = uint64(length) * 8;
+
+            memcpy(blocks[lane], messages[lane], length);
+            blocks[lane][length] = 0x80;
+            memset(blocks[lane] + length + 1, 0, padded - length - 1);
+            for (int i = 0; i < 8; ++i)
+                blocks[lane][padded - 1 - i] = uint8(bits >> (i * 8));
+
+            blockCount[lane] = padded / 64;
+            if (blockCount[lane] > longest)
+                longest = blockCount[lane];
+        }
+
+        V state[5];
+        for (int i = 0; i < 5; ++i)
+            for (int lane = 0; lane < lanes; ++lane)
+                state[i][lane] = InitialState[i];
+
+        for (int block = 0; block < longest; ++block)
+        {
+            // transposed into scalars first, inserting single lanes into vectors is slow
+            uint32 words[16][lanes];
+            uint32 mask[lanes];
+            bool allActive = true;
+
+            for (int lane = 0; lane < lanes; ++lane)
+            {
+                const bool inBlock = block < blockCount[lane];
+                uint8 const* data = inBlock ? blocks[lane] + block * 64 : blocks[0];   // finished lanes hash anything, masked below
+
+                for (int t = 0; t < 16; ++t)
+                {
+                    uint32 word;
+                    memcpy(&word, data + t * 4, sizeof(word));
+                    words[t][lane] = __builtin_bswap32(word);
+                }
+
+                mask[lane] = inBlock ? 0xFFFFFFFF : 0;
+                allActive = allActive && inBlock;
+            }
+
+            V w[16];
+            V active;
+            memcpy(w, words, sizeof(w));
+            memcpy(&active, mask, sizeof(active));
+
+            V previous[5];
+            memcpy(previous, state, sizeof(state));
+
+            Compress(state, w);
+
+            // lanes whose message already ended keep their digest
+            if (!allActive)
+                for (int i = 0; i < 5; ++i)
+                    state[i] = (state[i] & active) | (previous[i] & ~active);
+        }
+
+        for (int lane = 0; lane < count; ++lane)
+        {
+            uint8* digest = digests + lane * SHA_DIGEST_LENGTH;
+            for (int i = 0; i < 5; ++i)
+            {
+                const uint32 word = state[i][lane];
+                digest[i * 4] = uint8(word >> 24);
+                digest[i * 4 + 1] = uint8(word >> 16);
+                digest[i * 4 + 2] = uint8(word >> 8);
+                digest[i * 4 + 3] = uint8(word);
+            }
+        }
+    }
+
+    void Hash4(uint8 const* const* messages, int const* lengths, int count, uint8* digests)
+    {
+        HashLanes<Vector4>(messages, lengths, count, digests);
+    }
+
+#ifdef SHA1BATCH_AVX2
+    __attribute__((target("avx2")))
+    void Hash8(uint8 const* const* messages, int const* lengths, int count, uint8* digests)
+    {
+        HashLanes<Vector8>(messages, lengths, count, digests);
+    }
+#endif
+#endif
+
+    struct Dispatch
+    {
+        HashFunction hash;
+        int lanes;
+        char const* name;
+
+        Dispatch() : hash(&HashScalar), lanes(1), name("scalar")
+        {
+#ifdef SHA1BATCH_AVX2
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+            {
+                hash = &Hash8;
+                lanes = 8;
+                name = "avx2";
+                return;
+            }
+#endif
+#ifdef SHA1BATCH_VECTORS
+            hash = &Hash4;
+            lanes = 4;
+#if defined(__x86_64__) || defined(__i386__)
+            name = "sse2";
+#elif defined(__ARM_NEON)
+            name = "neon";
+#else
+            name = "vector";
+#endif
+#endif
+        }
+    };
+
+    Dispatch const& Selected()
+    {
+        static Dispatch const dispatch;
+        return dispatch;
+    }
+}
+
+void Sha1Batch::Hash(uint8 const* const* messages, int const* lengths, int count, uint8* digests)
+{
+    Dispatch const& dispatch = Selected();
+
+    uint8 const* laneMessages[MaxLanes];
+    int laneLengths[MaxLanes];
+    int laneIndex[MaxLanes];
+    uint8 laneDigests[MaxLanes * SHA_DIGEST_LENGTH];
+    int pending = 0;
+
+    for (int i = 0; i <= count; ++i)
+    {
+        // a lane group is flushed when full and at the end, one message alone is cheaper without lanes
+        if (pending == dispatch.lanes || (i == count && pending))
+        {
+            if (pending == 1)
+                HashScalar(laneMessages, laneLengths, 1, laneDigests);
+            else
+                dispatch.hash(laneMessages, laneLengths, pending, laneDigests);
+
+            for (int lane = 0; lane < pending; ++lane)
+                memcpy(digests + laneIndex[lane] * SHA_DIGEST_LENGTH, laneDigests + lane * SHA_DIGEST_LENGTH, SHA_DIGEST_LENGTH);
+            pending = 0;
+        }
+
+        if (i == count)
+            break;
+
+        if (lengths[i] > MaxLaneLength || dispatch.lanes == 1)
+        {
+            SHA1(messages[i], lengths[i], digests + i * SHA_DIGEST_LENGTH);
+            continue;
+        }
+
+        laneMessages[pending] = messages[i];
+        laneLengths[pending] = lengths[i];
+        laneIndex[pending] = i;
+        ++pending;
+    }
+}
+
+int Sha1Batch::Lanes()
+{
+    return Selected().lanes;
+}
+
+char const* Sha1Batch::Implementation()
+{
+    return Selected().name;
+}
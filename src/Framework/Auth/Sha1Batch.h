@@ -0,0 +1,42 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _AUTH_SHA1BATCH_H
+#define _AUTH_SHA1BATCH_H
+
+#include "Common.h"
+#include <openssl/sha.h>
+
+/// SHA1 of several independent short messages at once.  The messages are spread over the
+/// lanes of a SIMD register (8 with AVX2, 4 with SSE2/NEON) and compressed in one pass, the
+/// implementation is picked for the CPU at the first call.  Messages too long for the lanes
+/// and builds without vector support go through OpenSSL one by one.
+class Sha1Batch
+{
+    public:
+        static const int MaxLanes = 8;
+        static const int MaxLaneLength = 4 * 64 - 9;        // 4 blocks with the padding
+
+        /// digests + i * SHA_DIGEST_LENGTH receives SHA1(messages[i], lengths[i]) for i < count
+        static void Hash(uint8 const* const* messages, int const* lengths, int count, uint8* digests);
+
+        /// messages hashed in one pass on this CPU, 1 without SIMD
+        static int Lanes();
+        static char const* Implementation();
+};
+#endif
@@ -93,6 +93,25 @@ bool SqlConnection::ExecuteStmt(int nIndex, const SqlStmtParameters& id)
     return pStmt->execute();
 }
 
+QueryResult* SqlConnection::QueryStmt(int nIndex, const SqlStmtParameters& id, bool* failed)
+{
+    if (failed)
+        *failed = true;
+
+    if (nIndex == -1)
+        return nullptr;
+
+    // get prepared statement object
+    SqlPreparedStatement* pStmt = GetStmt(nIndex);
+    if (!pStmt || !pStmt->isQuery())
+        return nullptr;
+
+    // bind parameters
+    pStmt->bind(id);
+    // execute statement and collect its rows
+    return pStmt->query(failed);
+}
+
 //////////////////////////////////////////////////////////////////////////
 Database::~Database()
 {
@@ -188,6 +207,10 @@ void Database::InitDelayThread()
 
 void Database::HaltDelayThread()
 {
+    // queries still queued are dropped with their callbacks
+    if (m_queryThreads)
+        m_queryThreads->Stop();
+
     if (!m_threadBody || !m_delayThread) return;
 
     m_threadBody->Stop();                                   // Stop event
@@ -197,6 +220,14 @@ void Database::HaltDelayThread()
     m_threadBody = nullptr;
 }
 
+void Database::InitQueryThreads()
+{
+    assert(!m_queryThreads);
+
+    // a query holds its connection for the whole round trip, more threads than connections would only wait
+    m_queryThreads.reset(new MaNGOS::WorkerPool(m_nQueryConnPoolSize, [this] () { ThreadStart(); }, [this] () { ThreadEnd(); }));
+}
+
 void Database::ThreadStart()
 {
 }
@@ -435,10 +466,10 @@ bool Database::CommitTransactionDirect()
 
     // directly execute SqlTransaction
     auto const pTrans = m_currentTransaction.release();
-    pTrans->Execute(m_pAsyncConn);
+    bool const result = pTrans->Execute(m_pAsyncConn);
     delete pTrans;
 
-    return true;
+    return result;
 }
 
 bool Database::RollbackTransaction()
@@ -555,6 +586,87 @@ bool Database::DirectExecuteStmt(const SqlStatementID& id, SqlStmtParameters* pa
     return _guard->ExecuteStmt(id.ID(), *params);
 }
 
+QueryResult* Database::QueryStmt(const SqlStatementID& id, SqlStmtParameters* params, bool* failed)
+{
+    assert(params);
+    std::unique_ptr<SqlStmtParameters> p(params);
+    // query connections keep their own prepared copy of the statement
+    SqlConnection::Lock _guard(getQueryConnection());
+    return _guard->QueryStmt(id.ID(), *params, failed);
+}
+
+void Database::AsyncQueryMulti(std::string const& sql, SqlQueryMultiCallback callback)
+{
+    auto job = [this, sql, callback] ()
+    {
+        QueryResultList results;
+        bool failed;
+        {
+            SqlConnection::Lock guard(getQueryConnection());
+            failed = !guard->QueryMulti(sql.c_str(), results);
+        }
+        callback(results, failed);
+    };
+
+    if (m_queryThreads)
+        m_queryThreads->Post(job);
+    else
+        job();
+}
+
+void Database::AsyncQueryStmt(const SqlStatementID& id, SqlStmtParameters* params, SqlQueryCallback callback)
+{
+    assert(params);
+    if (!m_queryThreads)
+    {
+        bool failed;
+        QueryResult* result = QueryStmt(id, params, &failed);
+        callback(result, failed);
+        return;
+    }
+
+    // std::function needs a copyable job, the parameters are shared with it
+    std::shared_ptr<SqlStmtParameters> args(params);
+    int const index = id.ID();
+    m_queryThreads->Post([this, index, args, callback] ()
+    {
+        QueryResult* result;
+        bool failed;
+        {
+            SqlConnection::Lock guard(getQueryConnection());
+            result = guard->QueryStmt(index, *args, &failed);
+        }
+        callback(result, failed);
+    });
+}
+
+void Database::AsyncQueryStmt(const SqlStatementID& update, SqlStmtParameters* updateParams, const SqlStatementID& id, SqlStmtParameters* params, SqlQueryCallback callback)
+{
+    assert(updateParams && params);
+    std::shared_ptr<SqlStmtParameters> updateArgs(updateParams);
+    std::shared_ptr<SqlStmtParameters> args(params);
+    int const updateIndex = update.ID();
+    int const index = id.ID();
+
+    // the query may read what the update left in the session, LAST_INSERT_ID() for one
+    auto job = [this, updateIndex, updateArgs, index, args, callback] ()
+    {
+        QueryResult* result = nullptr;
+        bool failed = true;
+        {
+            SqlConnection::Lock guard(getQueryConnection());
+            if (guard->ExecuteStmt(updateIndex, *updateArgs))
+                result = guard->QueryStmt(index, *args, &failed);
+        }
+        callback(result, failed);
+    };
+
+    if (m_queryThreads)
+        m_queryThreads->Post(job);
+    else
+        job();
+}
+
 SqlStatement Database::CreateStatement(SqlStatementID& index, const char* fmt)
 {
     int nId = -1;
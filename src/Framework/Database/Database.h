@@ -21,11 +21,14 @@
 
 #include "Common.h"
 #include "Threading/Threading.h"
+#include "Threading/WorkerPool.h"
 #include "Database/SqlDelayThread.h"
 #include "SqlPreparedStatement.h"
+#include "QueryResult.h"
 
 #include <boost/thread/tss.hpp>
 #include <atomic>
+#include <memory>
 
 class SqlTransaction;
 class SqlResultQueue;
@@ -36,6 +39,9 @@ class Database;
 
 #define MAX_QUERY_LEN   (32*1024)
 
+// receives the results of an asynchronous multi-statement query and owns them, failed tells an error from no rows
+typedef std::function<void (QueryResultList& results, bool failed)> SqlQueryMultiCallback;
+
 //
 class SqlConnection
 {
@@ -47,6 +53,8 @@ class SqlConnection
         // public methods for making queries
         virtual QueryResult* Query(const char* sql) = 0;
         virtual QueryNamedResult* QueryNamed(const char* sql) = 0;
+        // several ';' separated statements in one round trip, false (and no results) when any of them fails
+        virtual bool QueryMulti(const char* /*sql*/, QueryResultList& /*results*/) { return false; }
 
         // public methods for making requests
         virtual bool Execute(const char* sql) = 0;
@@ -62,6 +70,7 @@ class SqlConnection
 
         // methods to work with prepared statements
         bool ExecuteStmt(int nIndex, const SqlStmtParameters& id);
+        QueryResult* QueryStmt(int nIndex, const SqlStmtParameters& id, bool* failed = nullptr);
 
         // SqlConnection object lock
         class Lock
@@ -110,8 +119,12 @@ class Database
         virtual bool Initialize(const char* infoString, int nConns = 1);
         // start worker thread for async DB request execution
         virtual void InitDelayThread();
-        // stop worker thread
+        // stop worker thread, and the query threads
         virtual void HaltDelayThread();
+        // start one thread per query connection for SqlStatement::AsyncQuery, which runs the query in the caller's thread without them
+        void InitQueryThreads();
+        // nullptr without query threads
+        MaNGOS::WorkerPool const* GetQueryThreads() const { return m_queryThreads.get(); }
 
         /// Synchronous DB queries
         inline QueryResult* Query(const char* sql)
@@ -126,6 +139,15 @@ class Database
             return guard->QueryNamed(sql);
         }
 
+        inline bool QueryMulti(const char* sql, QueryResultList& results)
+        {
+            SqlConnection::Lock guard(getQueryConnection());
+            return guard->QueryMulti(sql, results);
+        }
+
+        // same on one of the query threads, the callback runs there and owns the results
+        void AsyncQueryMulti(std::string const& sql, SqlQueryMultiCallback callback);
+
         QueryResult* PQuery(const char* format, ...) ATTR_PRINTF(2, 3);
         QueryNamedResult* PQueryNamed(const char* format, ...) ATTR_PRINTF(2, 3);
 
@@ -258,6 +280,11 @@ class Database
         // query function for prepared statements
         bool ExecuteStmt(const SqlStatementID& id, SqlStmtParameters* params);
         bool DirectExecuteStmt(const SqlStatementID& id, SqlStmtParameters* params);
+        // result returning statements, prepared once per query connection
+        QueryResult* QueryStmt(const SqlStatementID& id, SqlStmtParameters* params, bool* failed = nullptr);
+        void AsyncQueryStmt(const SqlStatementID& id, SqlStmtParameters* params, SqlQueryCallback callback);
+        // same, once update has been executed on that connection under the same lock, a failed update fails the query
+        void AsyncQueryStmt(const SqlStatementID& update, SqlStmtParameters* updateParams, const SqlStatementID& id, SqlStmtParameters* params, SqlQueryCallback callback);
 
         // connection helper counters
         int m_nQueryConnPoolSize;                           // current size of query connection pool
@@ -273,6 +300,7 @@ class Database
         SqlResultQueue*     m_pResultQueue;                 ///< Transaction queues from diff. threads
         SqlDelayThread*     m_threadBody;                   ///< Pointer to delay sql executer (owned by m_delayThread)
         MaNGOS::Thread*     m_delayThread;                  ///< Pointer to executer thread
+        std::unique_ptr<MaNGOS::WorkerPool> m_queryThreads; ///< Threads running asynchronous queries on the query connections
 
         bool m_bAllowAsyncTransactions;                     ///< flag which specifies if async transactions are enabled
 
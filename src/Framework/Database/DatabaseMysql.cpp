@@ -171,9 +171,24 @@ bool MySQLConnection::Initialize(const char* infoString)
     return true;
 }
 
+bool MySQLConnection::_SetMultiStatements(bool enable)
+{
+    if (mMultiStatements == enable)
+        return true;
+
+    if (mysql_set_server_option(mMysql, enable ? MYSQL_OPTION_MULTI_STATEMENTS_ON : MYSQL_OPTION_MULTI_STATEMENTS_OFF))
+    {
+        sLog.outErrorDb("SQL ERROR: cannot turn multiple statements %s: %s", enable ? "on" : "off", mysql_error(mMysql));
+        return false;
+    }
+
+    mMultiStatements = enable;
+    return true;
+}
+
 bool MySQLConnection::_Query(const char* sql, MYSQL_RES** pResult, MYSQL_FIELD** pFields, uint64* pRowCount, uint32* pFieldCount)
 {
-    if (!mMysql)
+    if (!mMysql || !_SetMultiStatements(false))
         return 0;
 
     uint32 _s = WorldTimer::getMSTime();
@@ -242,9 +257,65 @@ QueryNamedResult* MySQLConnection::QueryNamed(const char* sql)
     return new QueryNamedResult(queryResult, names);
 }
 
+bool MySQLConnection::QueryMulti(const char* sql, QueryResultList& results)
+{
+    // statements are only split while a QueryMulti runs: any other text query turns the option off again
+    // first, so that none of them can carry a second statement.  QueryMulti calls following each other on a
+    // connection, as the logon challenges do, skip the round trip of switching it
+    if (!mMysql || !_SetMultiStatements(true))
+        return false;
+
+    uint32 _s = WorldTimer::getMSTime();
+
+    if (mysql_query(mMysql, sql))
+    {
+        sLog.outErrorDb("SQL: %s", sql);
+        sLog.outErrorDb("query ERROR: %s", mysql_error(mMysql));
+        return false;
+    }
+
+    DEBUG_FILTER_LOG(LOG_FILTER_SQL_TEXT, "[%u ms] SQL: %s", WorldTimer::getMSTimeDiff(_s, WorldTimer::getMSTime()), sql);
+
+    size_t const first = results.size();
+    int status;
+    do
+    {
+        QueryResultMysql* queryResult = nullptr;
+        if (MYSQL_RES* result = mysql_store_result(mMysql))
+        {
+            uint64 const rowCount = mysql_num_rows(result);
+            if (rowCount)
+            {
+                queryResult = new QueryResultMysql(result, mysql_fetch_fields(result), rowCount, mysql_num_fields(result));
+                queryResult->NextRow();
+            }
+            else
+                mysql_free_result(result);
+        }
+        results.push_back(queryResult);
+
+        // 0: next result ready, -1: no more results, > 0: the next statement failed
+        status = mysql_next_result(mMysql);
+    }
+    while (!status);
+
+    if (status > 0)
+    {
+        sLog.outErrorDb("SQL: %s", sql);
+        sLog.outErrorDb("query ERROR: %s", mysql_error(mMysql));
+
+        for (size_t i = first; i < results.size(); ++i)
+            delete results[i];
+        results.resize(first);
+        return false;
+    }
+
+    return true;
+}
+
 bool MySQLConnection::Execute(const char* sql)
 {
-    if (!mMysql)
+    if (!mMysql || !_SetMultiStatements(false))
         return false;
 
     {
@@ -268,6 +339,9 @@ bool MySQLConnection::Execute(const char* sql)
 
 bool MySQLConnection::_TransactionCmd(const char* sql)
 {
+    if (!_SetMultiStatements(false))
+        return false;
+
     if (mysql_query(mMysql, sql))
     {
         sLog.outError("SQL: %s", sql);
@@ -313,7 +387,8 @@ SqlPreparedStatement* MySQLConnection::CreateStatement(const std::string& fmt)
 
 //////////////////////////////////////////////////////////////////////////
 MySqlPreparedStatement::MySqlPreparedStatement(const std::string& fmt, SqlConnection& conn, MYSQL* mysql) : SqlPreparedStatement(fmt, conn),
-    m_pMySQLConn(mysql), m_stmt(nullptr), m_pInputArgs(nullptr), m_pResult(nullptr), m_pResultMetadata(nullptr)
+    m_pMySQLConn(mysql), m_stmt(nullptr), m_pInputArgs(nullptr), m_pResult(nullptr), m_pResultLengths(nullptr), m_pResultNulls(nullptr),
+    m_pResultMetadata(nullptr)
 {
 }
 
@@ -338,6 +413,10 @@ bool MySqlPreparedStatement::prepare()
         return false;
     }
 
+    // let mysql_stmt_store_result() report the longest value of every column, it sizes the output buffers
+    my_bool updateMaxLength = 1;
+    mysql_stmt_attr_set(m_stmt, STMT_ATTR_UPDATE_MAX_LENGTH, &updateMaxLength);
+
     // prepare statement
     if (mysql_stmt_prepare(m_stmt, m_szFmt.c_str(), m_szFmt.length()))
     {
@@ -374,7 +453,11 @@ bool MySqlPreparedStatement::prepare()
         /* Get total columns in the query */
         m_nColumns = mysql_num_fields(m_pResultMetadata);
 
-        // bind output buffers
+        // bind output buffers, their data pointers are set for each query
+        m_pResult = new MYSQL_BIND[m_nColumns];
+        m_pResultLengths = new unsigned long[m_nColumns];
+        m_pResultNulls = new my_bool[m_nColumns];
+        memset(m_pResult, 0, sizeof(MYSQL_BIND) * m_nColumns);
     }
 
     m_bPrepared = true;
@@ -443,6 +526,8 @@ void MySqlPreparedStatement::RemoveBinds()
 
     delete[] m_pInputArgs;
     delete[] m_pResult;
+    delete[] m_pResultLengths;
+    delete[] m_pResultNulls;
 
     mysql_free_result(m_pResultMetadata);
     mysql_stmt_close(m_stmt);
@@ -450,6 +535,8 @@ void MySqlPreparedStatement::RemoveBinds()
     m_stmt = nullptr;
     m_pResultMetadata = nullptr;
     m_pResult = nullptr;
+    m_pResultLengths = nullptr;
+    m_pResultNulls = nullptr;
     m_pInputArgs = nullptr;
 
     m_bPrepared = false;
@@ -470,6 +557,93 @@ bool MySqlPreparedStatement::execute()
     return true;
 }
 
+QueryResult* MySqlPreparedStatement::query(bool* failed)
+{
+    if (failed)
+        *failed = true;
+
+    if (!isPrepared() || !isQuery())
+        return nullptr;
+
+    if (mysql_stmt_execute(m_stmt))
+    {
+        sLog.outError("SQL: cannot execute '%s'", m_szFmt.c_str());
+        sLog.outError("SQL ERROR: %s", mysql_stmt_error(m_stmt));
+        return nullptr;
+    }
+
+    if (mysql_stmt_store_result(m_stmt))
+    {
+        sLog.outError("SQL: cannot fetch the result of '%s'", m_szFmt.c_str());
+        sLog.outError("SQL ERROR: %s", mysql_stmt_error(m_stmt));
+        return nullptr;
+    }
+
+    const uint64 rowCount = mysql_stmt_num_rows(m_stmt);
+    if (!rowCount)
+    {
+        mysql_stmt_free_result(m_stmt);
+        if (failed)
+            *failed = false;
+        return nullptr;
+    }
+
+    // every column is fetched as text, as a plain query would return it. The metadata is read
+    // again as some client libraries copy it and only the new copy knows the longest values
+    MYSQL_RES* metadata = mysql_stmt_result_metadata(m_stmt);
+    if (!metadata)
+    {
+        mysql_stmt_free_result(m_stmt);
+        return nullptr;
+    }
+
+    MYSQL_FIELD* fields = mysql_fetch_fields(metadata);
+
+    size_t rowSize = 0;
+    for (uint32 i = 0; i < m_nColumns; ++i)
+        rowSize += fields[i].max_length + 1;
+
+    if (m_resultBuffer.size() < rowSize)
+        m_resultBuffer.resize(rowSize);
+
+    char* buffer = &m_resultBuffer[0];
+    for (uint32 i = 0; i < m_nColumns; ++i)
+    {
+        MYSQL_BIND& column = m_pResult[i];
+        column.buffer_type = MYSQL_TYPE_STRING;
+        column.buffer = buffer;
+        column.buffer_length = fields[i].max_length + 1;
+        column.length = &m_pResultLengths[i];
+        column.is_null = &m_pResultNulls[i];
+        buffer += column.buffer_length;
+    }
+
+    if (mysql_stmt_bind_result(m_stmt, m_pResult))
+    {
+        sLog.outError("SQL ERROR: mysql_stmt_bind_result() failed for '%s'", m_szFmt.c_str());
+        sLog.outError("SQL ERROR: %s", mysql_stmt_error(m_stmt));
+        mysql_free_result(metadata);
+        mysql_stmt_free_result(m_stmt);
+        return nullptr;
+    }
+
+    QueryResultMysqlStmt* result = new QueryResultMysqlStmt(fields, rowCount, m_nColumns);
+    mysql_free_result(metadata);
+
+    while (mysql_stmt_fetch(m_stmt) == 0)
+    {
+        for (uint32 i = 0; i < m_nColumns; ++i)
+            result->AddValue(static_cast<const char*>(m_pResult[i].buffer), m_pResultLengths[i], m_pResultNulls[i]);
+    }
+
+    mysql_stmt_free_result(m_stmt);
+
+    result->NextRow();
+    if (failed)
+        *failed = false;
+    return result;
+}
+
 enum_field_types MySqlPreparedStatement::ToMySQLType(const SqlStmtFieldData& data, my_bool& bUnsigned)
 {
     bUnsigned = 0;
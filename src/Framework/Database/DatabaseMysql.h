@@ -41,6 +41,9 @@ class MySqlPreparedStatement : public SqlPreparedStatement
         // execute DML statement
         virtual bool execute() override;
 
+        // execute SELECT statement, the rows are fetched as text into a QueryResultMysqlStmt
+        virtual QueryResult* query(bool* failed = nullptr) override;
+
     protected:
         // bind parameters
         void addParam(unsigned int nIndex, const SqlStmtFieldData& data);
@@ -54,13 +57,16 @@ class MySqlPreparedStatement : public SqlPreparedStatement
         MYSQL_STMT* m_stmt;
         MYSQL_BIND* m_pInputArgs;
         MYSQL_BIND* m_pResult;
+        unsigned long* m_pResultLengths;
+        my_bool* m_pResultNulls;
+        std::vector<char> m_resultBuffer;                   // one row, reused by every query
         MYSQL_RES* m_pResultMetadata;
 };
 
 class MySQLConnection : public SqlConnection
 {
     public:
-        MySQLConnection(Database& db) : SqlConnection(db), mMysql(nullptr) {}
+        MySQLConnection(Database& db) : SqlConnection(db), mMysql(nullptr), mMultiStatements(false) {}
         ~MySQLConnection();
 
         //! Initializes Mysql and connects to a server.
@@ -69,6 +75,7 @@ class MySQLConnection : public SqlConnection
 
         QueryResult* Query(const char* sql) override;
         QueryNamedResult* QueryNamed(const char* sql) override;
+        bool QueryMulti(const char* sql, QueryResultList& results) override;
         bool Execute(const char* sql) override;
 
         unsigned long escape_string(char* to, const char* from, unsigned long length);
@@ -86,8 +93,10 @@ class MySQLConnection : public SqlConnection
     private:
         bool _TransactionCmd(const char* sql);
         bool _Query(const char* sql, MYSQL_RES** pResult, MYSQL_FIELD** pFields, uint64* pRowCount, uint32* pFieldCount);
+        bool _SetMultiStatements(bool enable);
 
         MYSQL* mMysql;
+        bool mMultiStatements;                              ///< only ever set while QueryMulti calls follow each other
 };
 
 class DatabaseMysql : public Database
@@ -47,6 +47,9 @@ class QueryResult
 
 typedef std::vector<std::string> QueryFieldNames;
 
+// one entry per statement of a multi-statement query, nullptr for statements without rows
+typedef std::vector<QueryResult*> QueryResultList;
+
 class QueryNamedResult
 {
     public:
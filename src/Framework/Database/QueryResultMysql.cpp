@@ -68,7 +68,49 @@ void QueryResultMysql::EndQuery()
     }
 }
 
-enum Field::DataTypes QueryResultMysql::ConvertNativeType(enum_field_types mysqlType) const
+QueryResultMysqlStmt::QueryResultMysqlStmt(MYSQL_FIELD* fields, uint64 rowCount, uint32 fieldCount) :
+    QueryResult(rowCount, fieldCount), mNextRow(0)
+{
+    mCurrentRow = new Field[mFieldCount];
+
+    for (uint32 i = 0; i < mFieldCount; ++i)
+        mCurrentRow[i].SetType(QueryResultMysql::ConvertNativeType(fields[i].type));
+
+    mOffsets.reserve(rowCount * fieldCount);
+}
+
+QueryResultMysqlStmt::~QueryResultMysqlStmt()
+{
+    delete[] mCurrentRow;
+}
+
+void QueryResultMysqlStmt::AddValue(const char* value, unsigned long length, bool isNull)
+{
+    if (isNull)
+    {
+        mOffsets.push_back(-1);
+        return;
+    }
+
+    mOffsets.push_back(mData.size());
+    mData.insert(mData.end(), value, value + length);
+    mData.push_back('\0');
+}
+
+bool QueryResultMysqlStmt::NextRow()
+{
+    if (mNextRow >= mRowCount)
+        return false;
+
+    const int64* offsets = &mOffsets[mNextRow * mFieldCount];
+    for (uint32 i = 0; i < mFieldCount; ++i)
+        mCurrentRow[i].SetValue(offsets[i] < 0 ? nullptr : &mData[offsets[i]]);
+
+    ++mNextRow;
+    return true;
+}
+
+enum Field::DataTypes QueryResultMysql::ConvertNativeType(enum_field_types mysqlType)
 {
     switch (mysqlType)
     {
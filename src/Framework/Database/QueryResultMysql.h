@@ -23,6 +23,8 @@
 
 #include "Common.h"
 
+#include <vector>
+
 #ifdef _WIN32
 #include <WinSock2.h>
 #include <mysql.h>
@@ -40,11 +42,31 @@ class QueryResultMysql : public QueryResult
 
         bool NextRow() override;
 
+        static enum Field::DataTypes ConvertNativeType(enum_field_types mysqlType);
+
     private:
-        enum Field::DataTypes ConvertNativeType(enum_field_types mysqlType) const;
         void EndQuery();
 
         MYSQL_RES* mResult;
 };
+
+// rows of a prepared statement, copied out of the statement buffers as text
+class QueryResultMysqlStmt : public QueryResult
+{
+    public:
+        QueryResultMysqlStmt(MYSQL_FIELD* fields, uint64 rowCount, uint32 fieldCount);
+
+        ~QueryResultMysqlStmt();
+
+        // fill row by row and field by field before the first NextRow()
+        void AddValue(const char* value, unsigned long length, bool isNull);
+
+        bool NextRow() override;
+
+    private:
+        std::vector<char> mData;                            // all values, zero terminated
+        std::vector<int64> mOffsets;                        // start of every value in mData, -1 for NULL
+        uint64 mNextRow;
+};
 #endif
 #endif
@@ -82,6 +82,59 @@ bool SqlStatement::DirectExecute()
     return m_pDB->DirectExecuteStmt(m_index, args);
 }
 
+QueryResult* SqlStatement::Query()
+{
+    SqlStmtParameters* args = detach();
+    // verify amount of bound parameters
+    if (args->boundParams() != arguments())
+    {
+        sLog.outError("SQL ERROR: wrong amount of parameters (%i instead of %i)", args->boundParams(), arguments());
+        sLog.outError("SQL ERROR: statement: %s", m_pDB->GetStmtString(ID()).c_str());
+        assert(false);
+        delete args;
+        return nullptr;
+    }
+
+    return m_pDB->QueryStmt(m_index, args);
+}
+
+void SqlStatement::AsyncQuery(SqlQueryCallback callback)
+{
+    SqlStmtParameters* args = detach();
+    // verify amount of bound parameters
+    if (args->boundParams() != arguments())
+    {
+        sLog.outError("SQL ERROR: wrong amount of parameters (%i instead of %i)", args->boundParams(), arguments());
+        sLog.outError("SQL ERROR: statement: %s", m_pDB->GetStmtString(ID()).c_str());
+        assert(false);
+        delete args;
+        callback(nullptr, true);
+        return;
+    }
+
+    m_pDB->AsyncQueryStmt(m_index, args, std::move(callback));
+}
+
+void SqlStatement::AsyncQueryAfter(SqlStatement& update, SqlQueryCallback callback)
+{
+    SqlStmtParameters* updateArgs = update.detach();
+    SqlStmtParameters* args = detach();
+    // verify amount of bound parameters
+    if (updateArgs->boundParams() != update.arguments() || args->boundParams() != arguments())
+    {
+        sLog.outError("SQL ERROR: wrong amount of parameters (%i instead of %i, %i instead of %i)",
+                      updateArgs->boundParams(), update.arguments(), args->boundParams(), arguments());
+        sLog.outError("SQL ERROR: statements: %s; %s", m_pDB->GetStmtString(update.ID()).c_str(), m_pDB->GetStmtString(ID()).c_str());
+        assert(false);
+        delete updateArgs;
+        delete args;
+        callback(nullptr, true);
+        return;
+    }
+
+    m_pDB->AsyncQueryStmt(update.m_index, updateArgs, m_index, args, std::move(callback));
+}
+
 //////////////////////////////////////////////////////////////////////////
 SqlPlainPreparedStatement::SqlPlainPreparedStatement(const std::string& fmt, SqlConnection& conn) : SqlPreparedStatement(fmt, conn)
 {
@@ -132,6 +185,18 @@ bool SqlPlainPreparedStatement::execute()
     return m_pConn.Execute(m_szPlainRequest.c_str());
 }
 
+QueryResult* SqlPlainPreparedStatement::query(bool* failed)
+{
+    // a plain query returns nullptr for errors and empty results alike, only the missing request is known to fail
+    if (failed)
+        *failed = m_szPlainRequest.empty();
+
+    if (m_szPlainRequest.empty())
+        return nullptr;
+
+    return m_pConn.Query(m_szPlainRequest.c_str());
+}
+
 void SqlPlainPreparedStatement::DataToString(const SqlStmtFieldData& data, std::ostringstream& fmt) const
 {
     switch (data.type())
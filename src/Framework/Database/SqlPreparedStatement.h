@@ -21,6 +21,7 @@
 
 #include "Common.h"
 
+#include <functional>
 #include <vector>
 #include <stdexcept>
 
@@ -28,6 +29,10 @@ class Database;
 class SqlConnection;
 class QueryResult;
 
+// receives the result of an asynchronous query and owns it.  result is nullptr without rows and when the
+// query failed, which failed tells apart
+typedef std::function<void (QueryResult* result, bool failed)> SqlQueryCallback;
+
 union SqlStmtField
 {
     bool boolean;
@@ -207,6 +212,13 @@ class SqlStatement
         bool Execute();
         bool DirectExecute();
 
+        // run a SELECT statement on a query connection, nullptr when it returns no rows
+        QueryResult* Query();
+        // same on one of the database's query threads, the callback runs there
+        void AsyncQuery(SqlQueryCallback callback);
+        // same, once update has been executed on the same connection, for queries reading what it left in the session
+        void AsyncQueryAfter(SqlStatement& update, SqlQueryCallback callback);
+
         // templates to simplify 1-4 parameter bindings
         template<typename ParamType1>
         bool PExecute(ParamType1 param1)
@@ -242,6 +254,54 @@ class SqlStatement
             return Execute();
         }
 
+        template<typename ParamType1>
+        QueryResult* PQuery(ParamType1 param1)
+        {
+            arg(param1);
+            return Query();
+        }
+
+        template<typename ParamType1, typename ParamType2>
+        QueryResult* PQuery(ParamType1 param1, ParamType2 param2)
+        {
+            arg(param1);
+            arg(param2);
+            return Query();
+        }
+
+        template<typename ParamType1, typename ParamType2, typename ParamType3>
+        QueryResult* PQuery(ParamType1 param1, ParamType2 param2, ParamType3 param3)
+        {
+            arg(param1);
+            arg(param2);
+            arg(param3);
+            return Query();
+        }
+
+        template<typename ParamType1>
+        void AsyncPQuery(ParamType1 param1, SqlQueryCallback callback)
+        {
+            arg(param1);
+            AsyncQuery(std::move(callback));
+        }
+
+        template<typename ParamType1, typename ParamType2>
+        void AsyncPQuery(ParamType1 param1, ParamType2 param2, SqlQueryCallback callback)
+        {
+            arg(param1);
+            arg(param2);
+            AsyncQuery(std::move(callback));
+        }
+
+        template<typename ParamType1, typename ParamType2, typename ParamType3>
+        void AsyncPQuery(ParamType1 param1, ParamType2 param2, ParamType3 param3, SqlQueryCallback callback)
+        {
+            arg(param1);
+            arg(param2);
+            arg(param3);
+            AsyncQuery(std::move(callback));
+        }
+
         // bind parameters with specified type
         void addBool(bool var) { arg(var); }
         void addUInt8(uint8 var) { arg(var); }
@@ -314,6 +374,8 @@ class SqlPreparedStatement
 
         // execute statement w/o result set
         virtual bool execute() = 0;
+        // execute statement returning a result set, nullptr when it is empty or on error, which sets *failed
+        virtual QueryResult* query(bool* failed = nullptr) = 0;
 
     protected:
         SqlPreparedStatement(const std::string& fmt, SqlConnection& conn) :
@@ -343,6 +405,7 @@ class SqlPlainPreparedStatement : public SqlPreparedStatement
         virtual void bind(const SqlStmtParameters& holder) override;
 
         virtual bool execute() override;
+        virtual QueryResult* query(bool* failed = nullptr) override;
 
     protected:
         void DataToString(const SqlStmtFieldData& data, std::ostringstream& fmt) const;
@@ -0,0 +1,176 @@
+/*
+* This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "ConnectionLimiter.hpp"
+
+#include <boost/asio/ip/address.hpp>
+
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+
+using namespace MaNGOS;
+
+namespace
+{
+    uint64 NowMilliseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    ConnectionLimiter::AddressKey MakeKey(boost::asio::ip::address const& address)
+    {
+        ConnectionLimiter::AddressKey key;
+
+        if (address.is_v4())
+        {
+            // ipv4 addresses take the ipv4 mapped form, so they never collide with a real ipv6 address
+            auto const bytes = address.to_v4().to_bytes();
+
+            key.fill(0);
+            key[10] = key[11] = 0xFF;
+            memcpy(&key[12], &bytes[0], bytes.size());
+        }
+        else
+            key = address.to_v6().to_bytes();
+
+        return key;
+    }
+}
+
+size_t ConnectionLimiter::AddressKeyHash::operator()(AddressKey const& key) const
+{
+    // fnv-1a
+    uint64 hash = 14695981039346656037ULL;
+
+    for (auto const byte : key)
+    {
+        hash ^= byte;
+        hash *= 1099511628211ULL;
+    }
+
+    return static_cast<size_t>(hash ^ (hash >> 32));
+}
+
+ConnectionLimiter::ConnectionLimiter(ConnectionLimits const& limits) : m_limits(limits), m_live(0), m_rejected(0) {}
+
+void ConnectionLimiter::Refill(Entry& entry, uint64 now) const
+{
+    const uint64 capacity = uint64(std::max(m_limits.burstPerAddress, 1u)) * 1000;
+
+    entry.tokens = std::min(capacity, entry.tokens + (now - entry.lastRefill) * m_limits.newPerSecondPerAddress);
+    entry.lastRefill = now;
+}
+
+void ConnectionLimiter::Prune(Shard& shard, uint64 now) const
+{
+    for (auto i = shard.entries.begin(); i != shard.entries.end();)
+    {
+        if (!i->second.live)
+        {
+            Refill(i->second, now);
+
+            // a full bucket carries no history worth keeping
+            if (!m_limits.newPerSecondPerAddress || i->second.tokens >= uint64(std::max(m_limits.burstPerAddress, 1u)) * 1000)
+            {
+                i = shard.entries.erase(i);
+                continue;
+            }
+        }
+
+        ++i;
+    }
+}
+
+bool ConnectionLimiter::Admit(boost::asio::ip::address const& address, Ticket& ticket)
+{
+    // reserve the global slot first, it is the cheapest check
+    if (++m_live > m_limits.maxTotal && m_limits.maxTotal)
+    {
+        --m_live;
+        ++m_rejected;
+        return false;
+    }
+
+    const AddressKey key = MakeKey(address);
+    Shard& shard = ShardFor(key);
+    const uint64 now = NowMilliseconds();
+
+    {
+        std::lock_guard<std::mutex> guard(shard.mutex);
+
+        auto i = shard.entries.find(key);
+
+        if (i == shard.entries.end())
+        {
+            if (++shard.insertions >= PruneInterval)
+            {
+                shard.insertions = 0;
+                Prune(shard, now);
+            }
+
+            Entry entry;
+            entry.tokens = uint64(std::max(m_limits.burstPerAddress, 1u)) * 1000;
+            entry.lastRefill = now;
+
+            i = shard.entries.emplace(key, entry).first;
+        }
+
+        Entry& entry = i->second;
+
+        bool admitted = !m_limits.maxPerAddress || entry.live < m_limits.maxPerAddress;
+
+        if (admitted && m_limits.newPerSecondPerAddress)
+        {
+            Refill(entry, now);
+
+            if (entry.tokens >= 1000)
+                entry.tokens -= 1000;
+            else
+                admitted = false;
+        }
+
+        if (admitted)
+        {
+            ++entry.live;
+            ticket = Ticket(this, key);
+            return true;
+        }
+    }
+
+    --m_live;
+    ++m_rejected;
+
+    return false;
+}
+
+void ConnectionLimiter::Release(AddressKey const& key)
+{
+    Shard& shard = ShardFor(key);
+
+    {
+        std::lock_guard<std::mutex> guard(shard.mutex);
+
+        auto const i = shard.entries.find(key);
+
+        if (i != shard.entries.end() && i->second.live > 0)
+            --i->second.live;
+    }
+
+    --m_live;
+}
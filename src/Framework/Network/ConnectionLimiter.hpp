@@ -0,0 +1,148 @@
+/*
+* This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __CONNECTION_LIMITER_HPP_
+#define __CONNECTION_LIMITER_HPP_
+
+#include "Platform/Define.h"
+
+#include <boost/asio/ip/address.hpp>
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace MaNGOS
+{
+    // a value of 0 disables the corresponding limit
+    struct ConnectionLimits
+    {
+        uint32 maxTotal;                // live connections for the whole listener
+        uint32 maxPerAddress;           // live connections from one remote address
+        uint32 newPerSecondPerAddress;  // sustained rate of new connections from one remote address
+        uint32 burstPerAddress;         // new connections one remote address may open at once
+
+        ConnectionLimits() : maxTotal(0), maxPerAddress(0), newPerSecondPerAddress(0), burstPerAddress(0) {}
+
+        bool IsEnabled() const { return maxTotal || maxPerAddress || newPerSecondPerAddress; }
+    };
+
+    // admission control for accepted connections, checked before any socket object is built.
+    // per address state is spread over independently locked shards so accepting threads rarely meet.
+    class ConnectionLimiter
+    {
+        public:
+            typedef std::array<uint8, 16> AddressKey;
+
+            // an admitted connection.  gives its slot back when released or destroyed
+            class Ticket
+            {
+                private:
+                    ConnectionLimiter *m_limiter;
+                    AddressKey m_key;
+
+                public:
+                    Ticket() : m_limiter(nullptr) {}
+                    Ticket(ConnectionLimiter *limiter, AddressKey const& key) : m_limiter(limiter), m_key(key) {}
+                    Ticket(Ticket &&other) : m_limiter(other.m_limiter), m_key(other.m_key) { other.m_limiter = nullptr; }
+                    ~Ticket() { Release(); }
+
+                    Ticket(const Ticket&) = delete;
+                    Ticket& operator=(const Ticket&) = delete;
+
+                    Ticket& operator=(Ticket &&other)
+                    {
+                        if (this != &other)
+                        {
+                            Release();
+                            m_limiter = other.m_limiter;
+                            m_key = other.m_key;
+                            other.m_limiter = nullptr;
+                        }
+
+                        return *this;
+                    }
+
+                    void Release()
+                    {
+                        if (m_limiter)
+                            m_limiter->Release(m_key);
+
+                        m_limiter = nullptr;
+                    }
+            };
+
+        private:
+            static const size_t ShardCount = 64;
+
+            // entries which are idle and have a full bucket are pruned every PruneInterval insertions into a shard
+            static const uint32 PruneInterval = 1024;
+
+            struct AddressKeyHash
+            {
+                size_t operator()(AddressKey const& key) const;
+            };
+
+            struct Entry
+            {
+                uint32 live;
+                uint64 tokens;          // in thousandths of a connection
+                uint64 lastRefill;      // in milliseconds
+
+                Entry() : live(0), tokens(0), lastRefill(0) {}
+            };
+
+            struct Shard
+            {
+                std::mutex mutex;
+                std::unordered_map<AddressKey, Entry, AddressKeyHash> entries;
+                uint32 insertions;
+
+                Shard() : insertions(0) {}
+            };
+
+            const ConnectionLimits m_limits;
+
+            Shard m_shards[ShardCount];
+
+            std::atomic<uint32> m_live;
+            std::atomic<uint64> m_rejected;
+
+            Shard &ShardFor(AddressKey const& key) { return m_shards[AddressKeyHash()(key) % ShardCount]; }
+
+            void Refill(Entry &entry, uint64 now) const;
+            void Prune(Shard &shard, uint64 now) const;
+
+            void Release(AddressKey const& key);
+
+        public:
+            explicit ConnectionLimiter(ConnectionLimits const& limits);
+
+            ConnectionLimiter(const ConnectionLimiter&) = delete;
+            ConnectionLimiter& operator=(const ConnectionLimiter&) = delete;
+
+            // on success, the ticket holds the connection slot until released
+            bool Admit(boost::asio::ip::address const& address, Ticket &ticket);
+
+            uint32 GetLiveCount() const { return m_live; }
+            uint64 GetRejectedCount() const { return m_rejected; }
+    };
+}
+
+#endif /* !__CONNECTION_LIMITER_HPP_ */
\ No newline at end of file
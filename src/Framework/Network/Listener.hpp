@@ -20,9 +20,12 @@
 #define __LISTENER_HPP_
 
 #include "NetworkThread.hpp"
+#include "ConnectionLimiter.hpp"
+#include "Log/Log.h"
 
 #include <boost/asio.hpp>
 
+#include <cassert>
 #include <memory>
 #include <thread>
 #include <vector>
@@ -33,10 +36,20 @@ namespace MaNGOS
     class Listener
     {
         private:
+            typedef boost::asio::ip::tcp::acceptor Acceptor;
+
+            // the acceptor service is only used when all connections arrive on a single shared acceptor
             std::unique_ptr<boost::asio::io_service> m_service;
-            std::unique_ptr<boost::asio::ip::tcp::acceptor> m_acceptor;
+
+            // either one shared acceptor run by m_acceptorThread, or one SO_REUSEPORT acceptor per worker
+            std::vector<std::unique_ptr<Acceptor>> m_acceptors;
+            bool m_reusePort;
 
             std::thread m_acceptorThread;
+
+            // must outlive the workers, whose sockets hold tickets from it
+            std::unique_ptr<ConnectionLimiter> m_limiter;
+
             std::vector<std::unique_ptr<NetworkThread<SocketType>>> m_workerThreads;
 
             // the time in milliseconds to sleep a worker thread at the end of each tick
@@ -60,62 +73,203 @@ namespace MaNGOS
 
                 return m_workerThreads[minIndex].get();
             }
-            
-            void BeginAccept();
-            void OnAccept(NetworkThread<SocketType> *worker, std::shared_ptr<SocketType> const& socket, const boost::system::error_code &ec);
+
+            // a sharded acceptor always feeds the worker which owns it
+            NetworkThread<SocketType> *WorkerFor(size_t acceptorIndex) const
+            {
+                return m_reusePort ? m_workerThreads[acceptorIndex].get() : SelectWorker();
+            }
+
+            static bool OpenAcceptor(Acceptor &acceptor, boost::asio::ip::tcp::endpoint const& endpoint, bool reusePort);
+
+            void BeginAccept(size_t acceptorIndex);
+            void OnAccept(size_t acceptorIndex, NetworkThread<SocketType> *worker, std::shared_ptr<boost::asio::ip::tcp::socket> const& peer, const boost::system::error_code &ec);
 
         public:
-            Listener(std::string const& address, int port, int workerThreads);
+            // when bindWorkersToCpus is set, worker n is pinned to cpu (n % hardware_concurrency)
+            // when reusePort is set (and supported), every worker accepts its own connections and no acceptor thread is used
+            Listener(std::string const& address, int port, int workerThreads, bool bindWorkersToCpus = false, bool reusePort = false,
+                     ConnectionLimits const& limits = ConnectionLimits());
             ~Listener();
+
+            size_t WorkerCount() const { return m_workerThreads.size(); }
+            bool IsReusePort() const { return m_reusePort; }
+
+            uint64 GetRejectedConnections() const { return m_limiter ? m_limiter->GetRejectedCount() : 0; }
+
+            // buffer pool counters summed over all workers
+            PacketBufferPool::Stats GetBufferPoolStats() const
+            {
+                PacketBufferPool::Stats stats;
+
+                for (auto const& worker : m_workerThreads)
+                    stats += worker->GetBufferPoolStats();
+
+                return stats;
+            }
     };
 
     template <typename SocketType>
-    Listener<SocketType>::Listener(std::string const& address, int port, int workerThreads)
-        : m_service(new boost::asio::io_service()), m_acceptor(new boost::asio::ip::tcp::acceptor(*m_service, boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string(address), port)))
+    Listener<SocketType>::Listener(std::string const& address, int port, int workerThreads, bool bindWorkersToCpus, bool reusePort,
+                                   ConnectionLimits const& limits)
+        : m_reusePort(false), m_limiter(limits.IsEnabled() ? new ConnectionLimiter(limits) : nullptr)
     {
+        assert(workerThreads > 0);
+
+        const int cpuCount = static_cast<int>(std::thread::hardware_concurrency());
+
         m_workerThreads.reserve(workerThreads);
         for (auto i = 0; i < workerThreads; ++i)
-            m_workerThreads.push_back(std::unique_ptr<NetworkThread<SocketType>>(new NetworkThread<SocketType>));
+        {
+            const int cpu = (bindWorkersToCpus && cpuCount > 0) ? i % cpuCount : -1;
+            m_workerThreads.push_back(std::unique_ptr<NetworkThread<SocketType>>(new NetworkThread<SocketType>(cpu)));
+        }
+
+        const boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address::from_string(address), port);
+
+        if (reusePort)
+        {
+            for (auto const& worker : m_workerThreads)
+            {
+                std::unique_ptr<Acceptor> acceptor(new Acceptor(worker->GetService()));
+
+                if (!OpenAcceptor(*acceptor, endpoint, true))
+                {
+                    m_acceptors.clear();
+                    break;
+                }
+
+                m_acceptors.push_back(std::move(acceptor));
+            }
+
+            m_reusePort = !m_acceptors.empty();
+
+            if (!m_reusePort)
+                sLog.outError("Listener: SO_REUSEPORT is not available, falling back to a single acceptor thread");
+        }
 
-        BeginAccept();
+        if (m_reusePort)
+        {
+            for (size_t i = 0; i < m_acceptors.size(); ++i)
+                BeginAccept(i);
+        }
+        else
+        {
+            m_service.reset(new boost::asio::io_service());
+            m_acceptors.push_back(std::unique_ptr<Acceptor>(new Acceptor(*m_service, endpoint)));
+
+            BeginAccept(0);
 
-        m_acceptorThread = std::thread([this]() { this->m_service->run(); });
+            m_acceptorThread = std::thread([this]() { this->m_service->run(); });
+        }
     }
 
-    // FIXME - is this needed?
+    // stop accepting before the workers are torn down, so no new socket is handed to a stopped worker
     template <typename SocketType>
     Listener<SocketType>::~Listener()
     {
-        m_acceptor->close();
-        m_service->stop();
-        m_acceptorThread.join();
-        m_acceptor.reset();
+        if (m_service)
+        {
+            m_acceptors.front()->close();
+            m_service->stop();
+            m_acceptorThread.join();
+        }
+        else
+        {
+            // sharded acceptors live on the worker services, stop those before closing them
+            for (auto const& worker : m_workerThreads)
+                worker->Stop();
+        }
+
+        m_acceptors.clear();
         m_service.reset();
+
+        m_workerThreads.clear();
+    }
+
+    template <typename SocketType>
+    bool Listener<SocketType>::OpenAcceptor(Acceptor &acceptor, boost::asio::ip::tcp::endpoint const& endpoint, bool reusePort)
+    {
+#ifdef SO_REUSEPORT
+        typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port;
+#else
+        if (reusePort)
+            return false;
+#endif
+
+        boost::system::error_code ec;
+
+        acceptor.open(endpoint.protocol(), ec);
+        if (!ec)
+            acceptor.set_option(Acceptor::reuse_address(true), ec);
+#ifdef SO_REUSEPORT
+        if (!ec && reusePort)
+            acceptor.set_option(reuse_port(true), ec);
+#endif
+        if (!ec)
+            acceptor.bind(endpoint, ec);
+        if (!ec)
+            acceptor.listen(boost::asio::socket_base::max_connections, ec);
+
+        if (ec)
+        {
+            sLog.outError("Listener: unable to listen on %s:%u.  Error: %s", endpoint.address().to_string().c_str(), uint32(endpoint.port()), ec.message().c_str());
+            return false;
+        }
+
+        return true;
     }
 
     template <typename SocketType>
-    void Listener<SocketType>::BeginAccept()
+    void Listener<SocketType>::BeginAccept(size_t acceptorIndex)
     {
-        auto worker = SelectWorker();
-        auto socket = worker->CreateSocket();
+        auto worker = WorkerFor(acceptorIndex);
 
-        m_acceptor->async_accept(socket->GetAsioSocket(),
-            [this, worker, socket] (const boost::system::error_code &ec)
+        // accept into a bare asio socket, the session object is only built once the connection is admitted
+        std::shared_ptr<boost::asio::ip::tcp::socket> peer(new boost::asio::ip::tcp::socket(worker->GetService()));
+
+        m_acceptors[acceptorIndex]->async_accept(*peer,
+            [this, acceptorIndex, worker, peer] (const boost::system::error_code &ec)
         {
-            this->OnAccept(worker, socket, ec);
+            this->OnAccept(acceptorIndex, worker, peer, ec);
         });
     }
 
     template <typename SocketType>
-    void Listener<SocketType>::OnAccept(NetworkThread<SocketType> *worker, std::shared_ptr<SocketType> const& socket, const boost::system::error_code &ec)
+    void Listener<SocketType>::OnAccept(size_t acceptorIndex, NetworkThread<SocketType> *worker, std::shared_ptr<boost::asio::ip::tcp::socket> const& peer, const boost::system::error_code &ec)
     {
         // an error has occurred
         if (ec)
-            worker->RemoveSocket(socket.get());
+        {
+            // the acceptor has been closed, we are shutting down
+            if (ec == boost::asio::error::operation_aborted)
+                return;
+        }
         else
-            socket->Open();
+        {
+            ConnectionLimiter::Ticket ticket;
+            boost::system::error_code endpointError;
+
+            const boost::asio::ip::tcp::endpoint remote = peer->remote_endpoint(endpointError);
+
+            if (endpointError || (m_limiter && !m_limiter->Admit(remote.address(), ticket)))
+            {
+                boost::system::error_code ignored;
+                peer->close(ignored);
+            }
+            else
+            {
+                auto socket = worker->CreateSocket();
+
+                socket->GetAsioSocket() = std::move(*peer);
+                socket->SetAdmission(std::move(ticket));
+
+                // the session is run by its worker from the start, the shared acceptor thread only hands it over
+                worker->GetService().dispatch([socket] () { socket->Open(); });
+            }
+        }
 
-        BeginAccept();
+        BeginAccept(acceptorIndex);
     }
 }
 
@@ -20,12 +20,21 @@
 #define __NETWORK_THREAD_HPP_
 
 #include "Socket.hpp"
+#include "PacketBufferPool.hpp"
+#include "TimingWheel.hpp"
+#include "Log/Log.h"
 
 #include <boost/asio.hpp>
 
 #include <thread>
 #include <mutex>
 #include <unordered_set>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace MaNGOS
 {
@@ -33,26 +42,79 @@ namespace MaNGOS
     class NetworkThread
     {
         private:
+            // the pool and the wheel must outlive the service and the sockets, so they are declared first
+            PacketBufferPool m_bufferPool;
+            TimingWheel m_timingWheel;
+
             boost::asio::io_service m_service;
 
-            std::mutex m_socketLock;
+            mutable std::mutex m_socketLock;
             std::unordered_set<std::shared_ptr<SocketType>> m_sockets;
 
             // note that the work member *must* be declared after the service member for the work constructor to function correctly
             std::unique_ptr<boost::asio::io_service::work> m_work;
 
+            boost::asio::deadline_timer m_wheelTimer;
+
             std::thread m_serviceThread;
 
+            void Run()
+            {
+                boost::system::error_code ec;
+                m_service.run(ec);
+            }
+
+            void StartWheelTimer()
+            {
+                m_wheelTimer.expires_from_now(boost::posix_time::milliseconds(TimingWheel::TickInterval));
+                m_wheelTimer.async_wait([this] (const boost::system::error_code &error) { this->OnWheelTick(error); });
+            }
+
+            // closes all sessions whose deadline has passed in one go
+            void OnWheelTick(const boost::system::error_code &error)
+            {
+                if (error)
+                    return;
+
+                std::vector<std::shared_ptr<Socket>> expired;
+                m_timingWheel.Advance(expired);
+
+                for (auto const& socket : expired)
+                    socket->OnDeadline();
+
+                StartWheelTimer();
+            }
+
+            // restrict the service thread to a single cpu so its caches stay warm, no-op where unsupported
+            void BindToCpu(int cpu)
+            {
+#ifdef __linux__
+                cpu_set_t cpuSet;
+                CPU_ZERO(&cpuSet);
+                CPU_SET(cpu, &cpuSet);
+
+                if (int const error = pthread_setaffinity_np(m_serviceThread.native_handle(), sizeof(cpuSet), &cpuSet))
+                    sLog.outError("NetworkThread: unable to bind thread to cpu %d (error %d)", cpu, error);
+#else
+                (void)cpu;
+#endif
+            }
+
         public:
-            NetworkThread() : m_work(new boost::asio::io_service::work(m_service)), m_serviceThread([this] { boost::system::error_code ec; this->m_service.run(ec); })
+            // cpu < 0 leaves the thread placement to the operating system
+            explicit NetworkThread(int cpu = -1) : m_work(new boost::asio::io_service::work(m_service)), m_wheelTimer(m_service),
+                m_serviceThread(&NetworkThread::Run, this)
             {
-                m_serviceThread.detach();
+                if (cpu >= 0)
+                    BindToCpu(cpu);
+
+                StartWheelTimer();
             }
 
             ~NetworkThread()
             {
-                // Allow io_service::run() to exit.
-                m_work.reset();
+                // make sure nothing below races with the service thread
+                Stop();
 
                 // attempt to gracefully close any open connections
                 for (auto i = m_sockets.begin(); i != m_sockets.end();)
@@ -65,7 +127,25 @@ namespace MaNGOS
                 }
             }
 
-            size_t Size() const { return m_sockets.size(); }
+            // stop processing and wait for the service thread, the service itself stays valid until destruction
+            void Stop()
+            {
+                m_work.reset();
+                m_service.stop();
+
+                if (m_serviceThread.joinable())
+                    m_serviceThread.join();
+            }
+
+            boost::asio::io_service &GetService() { return m_service; }
+
+            PacketBufferPool::Stats GetBufferPoolStats() const { return m_bufferPool.GetStats(); }
+
+            size_t Size() const
+            {
+                std::lock_guard<std::mutex> guard(m_socketLock);
+                return m_sockets.size();
+            }
 
             std::shared_ptr<SocketType> CreateSocket();
 
@@ -81,7 +161,7 @@ namespace MaNGOS
     {
         std::lock_guard<std::mutex> guard(m_socketLock);
 
-        auto const i = m_sockets.emplace(std::make_shared<SocketType>(m_service, [this] (Socket *socket) { this->RemoveSocket(socket); }));
+        auto const i = m_sockets.emplace(std::make_shared<SocketType>(m_service, [this] (Socket *socket) { this->RemoveSocket(socket); }, m_bufferPool, m_timingWheel));
 
         assert(i.second);
 
@@ -18,35 +18,190 @@
 
 #include "Platform/Define.h"
 #include "PacketBuffer.hpp"
+#include "PacketBufferPool.hpp"
+
+#include <boost/asio/buffer.hpp>
 
 #include <cassert>
 #include <vector>
 #include <cstring>
+#include <algorithm>
 
 using namespace MaNGOS;
 
-PacketBuffer::PacketBuffer(int initialSize) : m_writePosition(0), m_readPosition(0), m_buffer(initialSize, 0) {}
+namespace
+{
+    size_t RoundUpToPowerOfTwo(size_t length)
+    {
+        size_t size = PacketBufferPool::MinBufferSize;
+
+        while (size < length)
+            size <<= 1;
+
+        return size;
+    }
+}
+
+std::atomic<uint64> PacketBuffer::s_totalMemory(0);
+
+PacketBuffer::PacketBuffer(PacketBufferPool* pool, std::atomic<uint64>* memoryUsage) : m_pool(pool), m_memoryUsage(memoryUsage), m_writePosition(0), m_readPosition(0), m_buffer(nullptr), m_size(0), m_pinned(false) {}
+
+PacketBuffer::~PacketBuffer()
+{
+    m_pinned = false;
+    m_readPosition = m_writePosition;
+
+    Unpin();
+}
+
+uint8* PacketBuffer::Allocate(size_t size)
+{
+    s_totalMemory += size;
+
+    if (m_memoryUsage)
+        *m_memoryUsage += size;
+
+    return m_pool ? m_pool->Acquire(size) : new uint8[size];
+}
+
+void PacketBuffer::Deallocate(uint8* buffer, size_t size)
+{
+    s_totalMemory -= size;
+
+    if (m_memoryUsage)
+        *m_memoryUsage -= size;
+
+    if (m_pool)
+        m_pool->Release(buffer, size);
+    else
+        delete[] buffer;
+}
+
+void PacketBuffer::Reserve(size_t length)
+{
+    if (length <= m_size)
+        return;
+
+    const size_t newSize = RoundUpToPowerOfTwo(length);
+    const size_t used = ReadLengthRemaining();
+
+    uint8* newBuffer = Allocate(newSize);
+
+    if (!!m_buffer)
+    {
+        // linearize the unread data at the start of the new storage
+        const size_t start = m_readPosition & Mask();
+        const size_t first = std::min(used, m_size - start);
+
+        memcpy(&newBuffer[0], &m_buffer[start], first);
+        memcpy(&newBuffer[first], &m_buffer[0], used - first);
+
+        if (m_pinned)
+            m_retired.push_back(std::make_pair(m_buffer, m_size));
+        else
+            Deallocate(m_buffer, m_size);
+    }
+
+    m_buffer = newBuffer;
+    m_size = newSize;
+    m_readPosition = 0;
+    m_writePosition = used;
+}
+
+void PacketBuffer::ReleaseIfEmpty()
+{
+    if (m_pinned || !m_buffer || ReadLengthRemaining() > 0)
+        return;
+
+    Deallocate(m_buffer, m_size);
+
+    m_buffer = nullptr;
+    m_size = 0;
+    m_readPosition = m_writePosition = 0;
+}
+
+void PacketBuffer::Unpin()
+{
+    m_pinned = false;
+
+    for (auto const& retired : m_retired)
+        Deallocate(retired.first, retired.second);
+
+    m_retired.clear();
+
+    ReleaseIfEmpty();
+}
 
 void PacketBuffer::Read(char* buffer, int length)
 {
     assert(ReadLengthRemaining() >= length);
 
     if (!!buffer)
-        memcpy(buffer, &m_buffer[m_readPosition], length);
+    {
+        const size_t start = m_readPosition & Mask();
+        const size_t first = std::min(static_cast<size_t>(length), m_size - start);
+
+        memcpy(buffer, &m_buffer[start], first);
+        memcpy(buffer + first, &m_buffer[0], length - first);
+    }
 
     m_readPosition += length;
+
+    // nothing left, hand the storage back until there is something to hold again
+    ReleaseIfEmpty();
 }
 
 void PacketBuffer::Write(const char* buffer, int length)
 {
     assert(!!buffer && !!length);
 
-    const size_t newLength = m_writePosition + length;
+    Reserve(ReadLengthRemaining() + length);
+
+    const size_t start = m_writePosition & Mask();
+    const size_t first = std::min(static_cast<size_t>(length), m_size - start);
+
+    memcpy(&m_buffer[start], buffer, first);
+    memcpy(&m_buffer[0], buffer + first, length - first);
 
-    if (m_buffer.size() < newLength)
-        m_buffer.resize(newLength);
+    m_writePosition += length;
+}
+
+PacketBuffer::ConstBuffers PacketBuffer::ReadableBuffers() const
+{
+    if (!m_buffer)
+        return ConstBuffers();
 
-    memcpy(&m_buffer[m_writePosition], buffer, length);
+    const size_t used = ReadLengthRemaining();
+    const size_t start = m_readPosition & Mask();
+    const size_t first = std::min(used, m_size - start);
+
+    ConstBuffers result =
+    {{
+        boost::asio::const_buffer(&m_buffer[start], first),
+        boost::asio::const_buffer(&m_buffer[0], used - first)
+    }};
+
+    return result;
+}
+
+PacketBuffer::MutableBuffers PacketBuffer::WritableBuffers(size_t limit)
+{
+    const size_t free = std::min(Free(), limit);
+    const size_t start = m_writePosition & Mask();
+    const size_t first = std::min(free, m_size - start);
+
+    MutableBuffers result =
+    {{
+        boost::asio::mutable_buffer(&m_buffer[start], first),
+        boost::asio::mutable_buffer(&m_buffer[0], free - first)
+    }};
+
+    return result;
+}
+
+void PacketBuffer::CommitWrite(size_t length)
+{
+    assert(length <= Free());
 
     m_writePosition += length;
-}
\ No newline at end of file
+}
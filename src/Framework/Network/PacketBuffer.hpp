@@ -20,33 +20,82 @@
 #define __PACKET_BUFFER_HPP_
 
 #include <vector>
+#include <array>
+#include <atomic>
 #include <functional>
 
-#include "Platform/Define.h"
+#include <boost/asio/buffer.hpp>
 
-#define DEFAULT_BUFFER_SIZE     6144
+#include "Platform/Define.h"
 
 namespace MaNGOS
 {
+    class PacketBufferPool;
+
+    // power of two ring buffer.  read and write positions only ever grow, the storage index is (position & mask),
+    // so partial reads and writes never move any data around.
+    // storage is only held while there is data in the buffer, and comes from the pool (if any) when needed again.
     class PacketBuffer
     {
         friend class Socket;
 
+        public:
+            // the second span is empty unless the region wraps around the end of the storage
+            typedef std::array<boost::asio::const_buffer, 2> ConstBuffers;
+            typedef std::array<boost::asio::mutable_buffer, 2> MutableBuffers;
+
         private:
+            // storage held by all packet buffers of the process
+            static std::atomic<uint64> s_totalMemory;
+
+            PacketBufferPool *m_pool;
+
+            // storage held by the buffers of one connection, may be null
+            std::atomic<uint64> *m_memoryUsage;
+
             size_t m_writePosition;
             size_t m_readPosition;
 
-            std::vector<uint8> m_buffer;
+            uint8 *m_buffer;
+            size_t m_size;
+
+            // while pinned, storage is kept alive because asio may still be using it
+            bool m_pinned;
+            std::vector<std::pair<uint8 *, size_t>> m_retired;
+
+            size_t Mask() const { return m_size - 1; }
+            size_t Free() const { return m_size - ReadLengthRemaining(); }
+
+            uint8 *Allocate(size_t size);
+            void Deallocate(uint8 *buffer, size_t size);
+
+            void Reserve(size_t length);
+            void ReleaseIfEmpty();
+
+            // spans of unread data, for scatter/gather sends
+            ConstBuffers ReadableBuffers() const;
+            // spans of free space (at most limit bytes), for scatter/gather receives.  CommitWrite() must be called with the amount received
+            MutableBuffers WritableBuffers(size_t limit = ~size_t(0));
+            void CommitWrite(size_t length);
+
+            void Pin() { m_pinned = true; }
+            void Unpin();
 
         public:
-            PacketBuffer(int initialSize = DEFAULT_BUFFER_SIZE);
+            explicit PacketBuffer(PacketBufferPool *pool = nullptr, std::atomic<uint64> *memoryUsage = nullptr);
+            ~PacketBuffer();
 
-            uint8 Peak() const { return m_buffer[m_readPosition]; }
+            PacketBuffer(const PacketBuffer&) = delete;
+            PacketBuffer& operator=(const PacketBuffer&) = delete;
+
+            uint8 Peak() const { return m_buffer[m_readPosition & Mask()]; }
 
             void Read(char *buffer, int length);
             int ReadLengthRemaining() const { return m_writePosition - m_readPosition; }
 
             void Write(const char *buffer, int length);
+
+            static uint64 GetTotalMemory() { return s_totalMemory; }
     };
 }
 
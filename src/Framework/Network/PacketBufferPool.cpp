@@ -0,0 +1,107 @@
+/*
+* This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "PacketBufferPool.hpp"
+
+#include <cassert>
+
+using namespace MaNGOS;
+
+PacketBufferPool::PacketBufferPool() : m_hits(0), m_misses(0), m_residentBytes(0), m_lentBytes(0) {}
+
+PacketBufferPool::~PacketBufferPool()
+{
+    for (auto const& freeList : m_free)
+        for (auto buffer : freeList)
+            delete[] buffer;
+}
+
+size_t PacketBufferPool::ClassIndex(size_t size)
+{
+    size_t index = 0;
+
+    for (size_t classSize = MinBufferSize; classSize < size; classSize <<= 1)
+        ++index;
+
+    return index;
+}
+
+uint8* PacketBufferPool::Acquire(size_t size)
+{
+    assert(size >= MinBufferSize && !(size & (size - 1)));
+
+    m_lentBytes += size;
+
+    if (size <= MaxBufferSize)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+
+        auto& freeList = m_free[ClassIndex(size)];
+
+        if (!freeList.empty())
+        {
+            uint8* buffer = freeList.back();
+            freeList.pop_back();
+
+            m_residentBytes -= size;
+            ++m_hits;
+
+            return buffer;
+        }
+    }
+
+    ++m_misses;
+
+    return new uint8[size];
+}
+
+void PacketBufferPool::Release(uint8* buffer, size_t size)
+{
+    assert(!!buffer);
+
+    m_lentBytes -= size;
+
+    if (size <= MaxBufferSize)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+
+        auto& freeList = m_free[ClassIndex(size)];
+
+        // keep the free lists bounded so a burst of connections does not pin its memory forever
+        if (freeList.size() * size < MaxResidentPerClass)
+        {
+            freeList.push_back(buffer);
+            m_residentBytes += size;
+            return;
+        }
+    }
+
+    delete[] buffer;
+}
+
+PacketBufferPool::Stats PacketBufferPool::GetStats() const
+{
+    Stats stats;
+
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.residentBytes = m_residentBytes;
+    stats.lentBytes = m_lentBytes;
+
+    return stats;
+}
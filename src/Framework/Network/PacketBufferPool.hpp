@@ -0,0 +1,86 @@
+/*
+* This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __PACKET_BUFFER_POOL_HPP_
+#define __PACKET_BUFFER_POOL_HPP_
+
+#include "Platform/Define.h"
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+namespace MaNGOS
+{
+    // recycles packet buffer storage in power of two size classes.  storage is handed out uninitialized.
+    // requests above the largest class bypass the pool.
+    class PacketBufferPool
+    {
+        public:
+            static const size_t MinBufferSize = 256;
+            static const size_t MaxBufferSize = 65536;
+
+            struct Stats
+            {
+                uint64 hits;            // requests served from a free list
+                uint64 misses;          // requests which had to allocate
+                uint64 residentBytes;   // bytes kept in the free lists
+                uint64 lentBytes;       // bytes currently used by buffers
+
+                Stats() : hits(0), misses(0), residentBytes(0), lentBytes(0) {}
+
+                Stats &operator += (Stats const& other)
+                {
+                    hits += other.hits;
+                    misses += other.misses;
+                    residentBytes += other.residentBytes;
+                    lentBytes += other.lentBytes;
+                    return *this;
+                }
+            };
+
+        private:
+            static const size_t ClassCount = 9;             // 256 .. 65536
+            static const size_t MaxResidentPerClass = 1024 * 1024;
+
+            std::mutex m_mutex;
+            std::vector<uint8 *> m_free[ClassCount];
+
+            std::atomic<uint64> m_hits;
+            std::atomic<uint64> m_misses;
+            std::atomic<uint64> m_residentBytes;
+            std::atomic<uint64> m_lentBytes;
+
+            static size_t ClassIndex(size_t size);
+
+        public:
+            PacketBufferPool();
+            ~PacketBufferPool();
+
+            PacketBufferPool(const PacketBufferPool&) = delete;
+            PacketBufferPool& operator=(const PacketBufferPool&) = delete;
+
+            // size must be a power of two, at least MinBufferSize
+            uint8 *Acquire(size_t size);
+            void Release(uint8 *buffer, size_t size);
+
+            Stats GetStats() const;
+    };
+}
+
+#endif /* !__PACKET_BUFFER_POOL_HPP_ */
\ No newline at end of file
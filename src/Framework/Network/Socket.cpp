@@ -18,6 +18,8 @@
 
 #include "Socket.hpp"
 #include "Log/Log.h"
+#include "PacketBufferPool.hpp"
+#include "TimingWheel.hpp"
 
 #include <boost/asio.hpp>
 #include <boost/date_time/posix_time/posix_time_types.hpp>
@@ -28,12 +30,17 @@
 #include <vector>
 #include <functional>
 #include <cstring>
+#include <algorithm>
 
 namespace MaNGOS
 {
-    Socket::Socket(boost::asio::io_service& service, std::function<void (Socket*)> closeHandler)
-        : m_writeState(WriteState::Idle), m_readState(ReadState::Idle), m_socket(service),
-          m_closeHandler(closeHandler), m_outBufferFlushTimer(service), m_address("0.0.0.0") {}
+    Socket::Socket(boost::asio::io_service& service, std::function<void (Socket*)> closeHandler, PacketBufferPool& bufferPool, TimingWheel& timingWheel)
+        : m_writeState(WriteState::Idle), m_readState(ReadState::Idle), m_processingIncoming(false), m_incomingSuspended(false),
+          m_service(service), m_socket(service),
+          m_closeHandler(closeHandler), m_bufferPool(bufferPool), m_timingWheel(timingWheel), m_deadlineTick(0),
+          m_memoryUsage(0), m_droppedInput(0), m_outBufferFlushTimer(service), m_address("0.0.0.0") {}
+
+    std::atomic<uint64> Socket::s_droppedInput(0);
 
     bool Socket::Open()
     {
@@ -48,9 +55,20 @@ namespace MaNGOS
             return false;
         }
 
-        m_outBuffer.reset(new PacketBuffer);
-        m_secondaryOutBuffer.reset(new PacketBuffer);
-        m_inBuffer.reset(new PacketBuffer);
+        m_outBuffer.reset(new PacketBuffer(&m_bufferPool, &m_memoryUsage));
+        m_inBuffer.reset(new PacketBuffer(&m_bufferPool, &m_memoryUsage));
+
+#ifndef _WIN32
+        // reads are done by hand once the socket is readable, see ReadAvailable()
+        boost::system::error_code ec;
+        m_socket.non_blocking(true, ec);
+
+        if (ec)
+        {
+            sLog.outError("Socket::Open() failed to set non blocking mode.  Error: %s", ec.message().c_str());
+            return false;
+        }
+#endif
 
         StartAsyncRead();
 
@@ -65,6 +83,9 @@ namespace MaNGOS
         m_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
         m_socket.close();
 
+        m_admission.Release();
+        m_deadlineTick = 0;
+
         if (m_closeHandler)
             m_closeHandler(this);
     }
@@ -79,11 +100,86 @@ namespace MaNGOS
 
         std::shared_ptr<Socket> ptr = shared<Socket>();
         m_readState = ReadState::Reading;
-        m_socket.async_read_some(boost::asio::buffer(&m_inBuffer->m_buffer[m_inBuffer->m_writePosition], m_inBuffer->m_buffer.size() - m_inBuffer->m_writePosition),
+
+#ifdef _WIN32
+        // completion based io needs the storage up front
+        if (m_inBuffer->Free() == 0)
+            m_inBuffer->Reserve(m_inBuffer->m_size + 1);
+
+        m_socket.async_read_some(m_inBuffer->WritableBuffers(),
+#else
+        // only wait for readiness, so that idle connections do not hold a buffer
+        m_socket.async_read_some(boost::asio::null_buffers(),
+#endif
                                  make_custom_alloc_handler(m_allocator,
         [ptr](const boost::system::error_code & error, size_t length) { ptr->OnRead(error, length); }));
     }
 
+    bool Socket::ReadAvailable()
+    {
+        const InputLimits limits = GetInputLimits();
+
+        boost::system::error_code ec;
+        size_t toRead = std::max<size_t>(m_socket.available(ec), 1);
+
+        // never hold more unprocessed input than allowed, whatever is left stays in the kernel until there is room
+        if (limits.maxBufferedInput)
+        {
+            if (size_t(m_inBuffer->ReadLengthRemaining()) >= limits.maxBufferedInput && !OnInputOverLimit())
+                return false;
+
+            toRead = std::min(toRead, limits.maxBufferedInput - m_inBuffer->ReadLengthRemaining());
+        }
+
+        m_inBuffer->Reserve(m_inBuffer->ReadLengthRemaining() + toRead);
+
+        const size_t length = m_socket.read_some(m_inBuffer->WritableBuffers(toRead), ec);
+
+        // spurious wakeup, hand the storage back and wait again
+        if (ec == boost::asio::error::would_block || ec == boost::asio::error::try_again)
+        {
+            m_inBuffer->ReleaseIfEmpty();
+            StartAsyncRead();
+            return false;
+        }
+
+        if (ec)
+        {
+            m_readState = ReadState::Idle;
+            OnError(ec);
+            return false;
+        }
+
+        m_inBuffer->CommitWrite(length);
+
+        return true;
+    }
+
+    // returns false if the connection has been closed
+    bool Socket::OnInputOverLimit()
+    {
+        if (GetInputLimits().action == OverLimitAction::Close)
+        {
+            sLog.outBasic("Socket::OnInputOverLimit.  %s exceeded the input limits.  Connection closed.", m_remoteEndpoint.c_str());
+
+            m_readState = ReadState::Idle;
+
+            if (!IsClosed())
+                Close();
+
+            return false;
+        }
+
+        const size_t dropped = m_inBuffer->ReadLengthRemaining();
+
+        m_inBuffer->Read(nullptr, dropped);
+
+        m_droppedInput += dropped;
+        s_droppedInput += dropped;
+
+        return true;
+    }
+
     void Socket::OnRead(const boost::system::error_code& error, size_t length)
     {
         if (error)
@@ -99,35 +195,70 @@ namespace MaNGOS
             return;
         }
 
-        m_inBuffer->m_writePosition += length;
+#ifdef _WIN32
+        m_inBuffer->CommitWrite(length);
+
+        const size_t maxBufferedInput = GetInputLimits().maxBufferedInput;
+
+        if (maxBufferedInput && size_t(m_inBuffer->ReadLengthRemaining()) > maxBufferedInput)
+        {
+            if (OnInputOverLimit())
+                StartAsyncRead();
+
+            return;
+        }
 
         const size_t available = m_socket.available();
 
         // if there is still data to read, increase the buffer size and do so (if necessary)
-        if (available > 0 && (length + available) > m_inBuffer->m_buffer.size())
+        if (available > m_inBuffer->Free() && (!maxBufferedInput || size_t(m_inBuffer->ReadLengthRemaining()) < maxBufferedInput))
         {
-            m_inBuffer->m_buffer.resize(m_inBuffer->m_buffer.size() + available);
+            m_inBuffer->Reserve(m_inBuffer->ReadLengthRemaining() + available);
             StartAsyncRead();
             return;
         }
+#else
+        if (!ReadAvailable())
+            return;
+#endif
+
+        ProcessIncoming(nullptr);
+    }
+
+    void Socket::ProcessIncoming(std::function<bool ()> const& continuation)
+    {
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_processingIncoming = true;
+        }
+
+        if (continuation && !continuation())
+        {
+            EndIncomingProcessing();
+            m_readState = ReadState::Idle;
+
+            if (!IsClosed())
+                Close();
+
+            return;
+        }
 
         // we must repeat this in case we have read in multiple messages from the client
-        while (m_inBuffer->m_readPosition < m_inBuffer->m_writePosition)
+        while (!m_incomingSuspended && m_inBuffer->m_readPosition < m_inBuffer->m_writePosition)
         {
             if (!ProcessIncomingData())
             {
+                EndIncomingProcessing();
+
                 // this errno is set when there is not enough buffer data available to either complete a header, or the packet length
-                // specified in the header goes past what we've read.  in this case, we will reset the buffer with the remaining data
+                // specified in the header goes past what we've read.  in this case, we keep the remaining data and read on after it
                 if (errno == EBADMSG)
                 {
-                    const size_t bytesRemaining = m_inBuffer->m_writePosition - m_inBuffer->m_readPosition;
-
-                    ::memmove(&m_inBuffer->m_buffer[0], &m_inBuffer->m_buffer[m_inBuffer->m_readPosition], bytesRemaining);
-
-                    m_inBuffer->m_readPosition = 0;
-                    m_inBuffer->m_writePosition = bytesRemaining;
+                    // a packet which cannot be valid, do not wait for the rest of it
+                    const size_t maxPacketSize = GetInputLimits().maxPacketSize;
 
-                    StartAsyncRead();
+                    if (!maxPacketSize || size_t(m_inBuffer->ReadLengthRemaining()) <= maxPacketSize || OnInputOverLimit())
+                        StartAsyncRead();
                 }
                 else if (!IsClosed())
                     Close();
@@ -136,12 +267,49 @@ namespace MaNGOS
             }
         }
 
-        // at this point, the packet has been read and successfully processed.  reset the buffer.
-        m_inBuffer->m_writePosition = m_inBuffer->m_readPosition = 0;
+        EndIncomingProcessing();
 
+        // reading resumes with the handler, in ResumeIncoming()
+        if (m_incomingSuspended)
+        {
+            m_readState = ReadState::Idle;
+            return;
+        }
+
+        // at this point, the packet has been read and successfully processed.  the buffer rewinds itself once drained.
         StartAsyncRead();
     }
 
+    void Socket::ResumeIncoming(std::function<bool ()> continuation)
+    {
+        std::shared_ptr<Socket> ptr = shared<Socket>();
+        m_service.post([ptr, continuation] ()
+        {
+            ptr->m_incomingSuspended = false;
+
+            if (ptr->IsClosed())
+                return;
+
+            ptr->ProcessIncoming(continuation);
+        });
+    }
+
+    void Socket::SetDeadline(uint32 milliseconds)
+    {
+        if (milliseconds)
+            m_timingWheel.Schedule(shared<Socket>(), milliseconds);
+        else
+            m_deadlineTick = 0;
+    }
+
+    void Socket::OnDeadline()
+    {
+        DEBUG_LOG("Socket::OnDeadline.  Connection from %s timed out.", m_remoteEndpoint.c_str());
+
+        if (!IsClosed())
+            Close();
+    }
+
     void Socket::OnError(const boost::system::error_code& error)
     {
         // skip logging this code because it happens whenever anyone disconnects.  reduces spam.
@@ -166,33 +334,59 @@ namespace MaNGOS
     {
         std::lock_guard<std::mutex> guard(m_mutex);
 
-        // get the correct buffer depending on the current writing state
-        PacketBuffer* outBuffer = m_writeState == WriteState::Sending ? m_secondaryOutBuffer.get() : m_outBuffer.get();
-
+        // while sending, this lands after the data in flight and goes out with the next send
         // write the header
-        outBuffer->Write(header, headerSize);
+        m_outBuffer->Write(header, headerSize);
 
         // write the content
-        outBuffer->Write(content, contentSize);
+        m_outBuffer->Write(content, contentSize);
 
         // flush data if need
         if (m_writeState == WriteState::Idle)
-            StartWriteFlushTimer();
+            ScheduleFlush();
     }
 
     void Socket::Write(const char* buffer, int length)
     {
         std::lock_guard<std::mutex> guard(m_mutex);
 
-        // get the correct buffer depending on the current writing state
-        PacketBuffer* outBuffer = m_writeState == WriteState::Sending ? m_secondaryOutBuffer.get() : m_outBuffer.get();
-
-        // write the header
-        outBuffer->Write(buffer, length);
+        // while sending, this lands after the data in flight and goes out with the next send
+        m_outBuffer->Write(buffer, length);
 
         // flush data if need
         if (m_writeState == WriteState::Idle)
-            StartWriteFlushTimer();
+            ScheduleFlush();
+    }
+
+// note that this function assumes that the socket mutex is locked and the write state is idle
+    void Socket::ScheduleFlush()
+    {
+        switch (GetFlushPolicy())
+        {
+            case FlushPolicy::Immediate:
+                StartSend();
+                break;
+            case FlushPolicy::EndOfProcessing:
+                // EndIncomingProcessing() will pick this up, writes from outside of processing go out right away
+                if (m_processingIncoming)
+                    m_writeState = WriteState::Buffering;
+                else
+                    StartSend();
+                break;
+            case FlushPolicy::Timed:
+                StartWriteFlushTimer();
+                break;
+        }
+    }
+
+    void Socket::EndIncomingProcessing()
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+
+        m_processingIncoming = false;
+
+        if (m_writeState == WriteState::Buffering && GetFlushPolicy() == FlushPolicy::EndOfProcessing)
+            StartSend();
     }
 
 // note that this function assumes that the socket mutex is locked
@@ -228,11 +422,27 @@ namespace MaNGOS
 
         assert(m_writeState == WriteState::Buffering);
 
-        // at this point we are guarunteed that there is data to send in the primary buffer.  send it.
+        StartSend();
+    }
+
+// note that this function assumes that the socket mutex is locked
+    void Socket::StartSend()
+    {
+        // if the socket is closed, silently fail
+        if (IsClosed())
+        {
+            m_writeState = WriteState::Idle;
+            return;
+        }
+
+        // at this point we are guarunteed that there is data to send in the buffer.  send it.
         m_writeState = WriteState::Sending;
 
+        // keep the storage handed to asio alive should a write grow the buffer before this completes
+        m_outBuffer->Pin();
+
         std::shared_ptr<Socket> ptr = shared<Socket>();
-        m_socket.async_write_some(boost::asio::buffer(m_outBuffer->m_buffer, m_outBuffer->m_writePosition),
+        m_socket.async_write_some(m_outBuffer->ReadableBuffers(),
                                   make_custom_alloc_handler(m_allocator,
         [ptr](const boost::system::error_code & error, size_t length) { ptr->OnWriteComplete(error, length); }));
     }
@@ -240,9 +450,19 @@ namespace MaNGOS
 // if the write state is idle, this will do nothing, which is correct
 // if the write state is sending, this will do nothing, which is correct
 // if the write state is buffering, this will cancel the running timer, which will immediately trigger FlushOut()
+// without a timer (end of processing policy), the buffered data is sent directly
     void Socket::ForceFlushOut()
     {
-        m_outBufferFlushTimer.cancel();
+        if (GetFlushPolicy() == FlushPolicy::Timed)
+        {
+            m_outBufferFlushTimer.cancel();
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(m_mutex);
+
+        if (m_writeState == WriteState::Buffering)
+            StartSend();
     }
 
     void Socket::OnWriteComplete(const boost::system::error_code& error, size_t length)
@@ -264,37 +484,15 @@ namespace MaNGOS
         std::lock_guard<std::mutex> guard(m_mutex);
 
         assert(m_writeState == WriteState::Sending);
-        assert(length <= m_outBuffer->m_writePosition);
+        assert(length <= static_cast<size_t>(m_outBuffer->ReadLengthRemaining()));
 
-        // if there is data left to write, move it to the start of the buffer
-        if (length < m_outBuffer->m_writePosition)
-        {
-            memcpy(&(m_outBuffer->m_buffer[0]), &(m_outBuffer->m_buffer[length]), (m_outBuffer->m_writePosition - length) * sizeof(m_outBuffer->m_buffer[0]));
-            m_outBuffer->m_writePosition -= length;
-        }
-        // if not, reset the write pointer
-        else
-            m_outBuffer->m_writePosition = 0;
-
-        // if there is data in the secondary buffer, append it to the primary buffer
-        if (m_secondaryOutBuffer->m_writePosition > 0)
-        {
-            // do we have enough space? if not, resize
-            if (m_outBuffer->m_buffer.size() < (m_outBuffer->m_writePosition + m_secondaryOutBuffer->m_writePosition))
-                m_outBuffer->m_buffer.resize(m_outBuffer->m_writePosition + m_secondaryOutBuffer->m_writePosition);
+        // drop what has been sent, whatever is left (including writes made meanwhile) follows directly after it
+        m_outBuffer->Read(nullptr, length);
+        m_outBuffer->Unpin();
 
-            memcpy(&(m_outBuffer->m_buffer[m_outBuffer->m_writePosition]), &(m_secondaryOutBuffer->m_buffer[0]), (m_secondaryOutBuffer->m_writePosition) * sizeof(m_secondaryOutBuffer->m_buffer[0]));
-
-            m_outBuffer->m_writePosition += m_secondaryOutBuffer->m_writePosition;
-            m_secondaryOutBuffer->m_writePosition = 0;
-        }
-
-        std::shared_ptr<Socket> ptr = shared<Socket>();
         // if there is any data to write, do so immediately
-        if (m_outBuffer->m_writePosition > 0)
-            m_socket.async_write_some(boost::asio::buffer(m_outBuffer->m_buffer, m_outBuffer->m_writePosition),
-                                      make_custom_alloc_handler(m_allocator,
-            [ptr](const boost::system::error_code & error, size_t length) { ptr->OnWriteComplete(error, length);}));
+        if (m_outBuffer->ReadLengthRemaining() > 0)
+            StartSend();
         else
             m_writeState = WriteState::Idle;
     }
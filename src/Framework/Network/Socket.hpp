@@ -20,6 +20,7 @@
 #define __SOCKET_HPP_
 
 #include "PacketBuffer.hpp"
+#include "ConnectionLimiter.hpp"
 
 #include "Platform/Define.h"
 
@@ -28,12 +29,45 @@
 #include <memory>
 #include <string>
 #include <mutex>
+#include <atomic>
 #include <functional>
 
 namespace MaNGOS
 {
+    class PacketBufferPool;
+    class TimingWheel;
+
     class Socket : public std::enable_shared_from_this<Socket>
     {
+        friend class TimingWheel;
+
+        public:
+            // when buffered output is handed to the kernel
+            enum class FlushPolicy
+            {
+                Immediate,          // every write is sent as soon as possible
+                EndOfProcessing,    // writes made while processing a read are sent together once processing is done
+                Timed,              // writes are collected for BufferTimeout milliseconds before being sent
+            };
+
+            // what happens to a connection which exceeds its input limits
+            enum class OverLimitAction
+            {
+                Close,              // the connection is closed
+                DropAndCount,       // the unprocessed input is discarded and counted, the connection stays
+            };
+
+            // bounds on unprocessed input, a value of 0 means unlimited
+            struct InputLimits
+            {
+                size_t maxPacketSize;       // largest incomplete packet kept while waiting for the rest of it
+                size_t maxBufferedInput;    // most unprocessed input held at once
+                OverLimitAction action;
+
+                InputLimits(size_t packet = 0, size_t buffered = 0, OverLimitAction overLimit = OverLimitAction::Close)
+                    : maxPacketSize(packet), maxBufferedInput(buffered), action(overLimit) {}
+            };
+
         private:
             // buffer timeout period, in milliseconds.  higher values decrease responsiveness
             // ingame but increase bandwidth efficiency by reducing tcp overhead.
@@ -55,24 +89,53 @@ namespace MaNGOS
             WriteState m_writeState;
             ReadState m_readState;
 
+            // set while ProcessIncomingData() is running, guarded by m_mutex
+            bool m_processingIncoming;
+
+            // set while a handler finishes its work elsewhere, input is neither read nor processed meanwhile
+            bool m_incomingSuspended;
+
+            boost::asio::io_service &m_service;
             boost::asio::ip::tcp::socket m_socket;
 
             std::function<void(Socket *)> m_closeHandler;
 
+            // shared by all sockets of a network thread, buffers only hold storage while carrying data
+            PacketBufferPool &m_bufferPool;
+
+            // the slot granted by the listener's admission control, released on close
+            ConnectionLimiter::Ticket m_admission;
+
+            // deadlines are kept by the network thread's timing wheel, m_deadlineTick identifies the current one (0 = none)
+            TimingWheel &m_timingWheel;
+            std::atomic<uint64> m_deadlineTick;
+
+            // storage held by this connection's buffers, and input dropped because of the input limits
+            std::atomic<uint64> m_memoryUsage;
+            uint64 m_droppedInput;
+
+            static std::atomic<uint64> s_droppedInput;
+
             std::unique_ptr<PacketBuffer> m_inBuffer;
             std::unique_ptr<PacketBuffer> m_outBuffer;
-            std::unique_ptr<PacketBuffer> m_secondaryOutBuffer;
 
             std::mutex m_mutex;
             boost::asio::deadline_timer m_outBufferFlushTimer;
 
             void StartAsyncRead();
             void OnRead(const boost::system::error_code &error, size_t length);
+            void ProcessIncoming(std::function<bool ()> const &continuation);
+            bool ReadAvailable();
+            bool OnInputOverLimit();
 
             void StartWriteFlushTimer();
             void OnWriteComplete(const boost::system::error_code &error, size_t length);
             void FlushOut();
 
+            void ScheduleFlush();
+            void StartSend();
+            void EndIncomingProcessing();
+
             void OnError(const boost::system::error_code &error);
 
         protected:
@@ -81,19 +144,41 @@ namespace MaNGOS
 
             virtual bool ProcessIncomingData() = 0;
 
-            const uint8 *InPeak() const { return &m_inBuffer->m_buffer[m_inBuffer->m_readPosition]; }
+            // timed batching suits chatty protocols, request/response protocols should override this
+            virtual FlushPolicy GetFlushPolicy() const { return FlushPolicy::Timed; }
+
+            // input is unbounded by default, protocols with small messages should override this
+            virtual InputLimits GetInputLimits() const { return InputLimits(); }
+
+            uint8 InPeak() const { return m_inBuffer->Peak(); }
 
             int ReadLengthRemaining() const { return m_inBuffer->ReadLengthRemaining(); }
 
             void ForceFlushOut();
 
+            // called by a handler which continues asynchronously, the rest of the input waits for ResumeIncoming()
+            void SuspendIncoming() { m_incomingSuspended = true; }
+            bool IsIncomingSuspended() const { return m_incomingSuspended; }
+
+            // may be called from any thread.  the continuation runs on the socket's own thread as if it were
+            // a handler (returning false closes the connection), then the waiting input is processed
+            void ResumeIncoming(std::function<bool ()> continuation);
+
+            // the connection is handed to OnDeadline() once this many milliseconds pass, 0 removes the deadline
+            void SetDeadline(uint32 milliseconds);
+
         public:
-            Socket(boost::asio::io_service &service, std::function<void (Socket *)> closeHandler);
+            Socket(boost::asio::io_service &service, std::function<void (Socket *)> closeHandler, PacketBufferPool &bufferPool, TimingWheel &timingWheel);
             virtual ~Socket() = default;
 
             virtual bool Open();
             void Close();
 
+            void SetAdmission(ConnectionLimiter::Ticket &&ticket) { m_admission = std::move(ticket); }
+
+            // called by the network thread once the deadline has passed, closes the connection by default
+            virtual void OnDeadline();
+
             bool IsClosed() const { return !m_socket.is_open(); }
             virtual bool Deletable() const { return IsClosed(); }
 
@@ -105,6 +190,13 @@ namespace MaNGOS
 
             boost::asio::ip::tcp::socket &GetAsioSocket() { return m_socket; }
 
+            uint64 GetMemoryUsage() const { return m_memoryUsage; }
+            uint64 GetDroppedInput() const { return m_droppedInput; }
+
+            // totals over all connections of the process
+            static uint64 GetTotalMemoryUsage() { return PacketBuffer::GetTotalMemory(); }
+            static uint64 GetTotalDroppedInput() { return s_droppedInput; }
+
             const std::string &GetRemoteEndpoint() const { return m_remoteEndpoint; }
             const std::string &GetRemoteAddress() const { return m_address; }
 
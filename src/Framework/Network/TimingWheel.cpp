@@ -0,0 +1,82 @@
+/*
+* This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "TimingWheel.hpp"
+#include "Socket.hpp"
+
+#include <algorithm>
+
+using namespace MaNGOS;
+
+TimingWheel::TimingWheel() : m_start(std::chrono::steady_clock::now()), m_currentTick(0) {}
+
+void TimingWheel::Schedule(std::shared_ptr<Socket> const& socket, uint32 milliseconds)
+{
+    // the tick of now rather than m_currentTick, which lags behind whenever Advance() runs late.  the partial tick
+    // already elapsed is not counted, one more tick on top of the rounded up delay keeps a deadline from firing early
+    const uint64 nowTick = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_start).count() / TickInterval;
+    const uint64 tick = nowTick + (milliseconds + TickInterval - 1) / TickInterval + 1;
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    socket->m_deadlineTick = tick;
+
+    Entry entry;
+    entry.socket = socket;
+    entry.tick = tick;
+
+    m_slots[tick % SlotCount].push_back(entry);
+}
+
+void TimingWheel::Advance(std::vector<std::shared_ptr<Socket>>& expired)
+{
+    const uint64 nowTick = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_start).count() / TickInterval;
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    if (nowTick <= m_currentTick)
+        return;
+
+    // after a long stall every slot is visited once, which still covers all deadlines up to now
+    const uint64 steps = std::min<uint64>(nowTick - m_currentTick, SlotCount);
+
+    for (uint64 step = 1; step <= steps; ++step)
+    {
+        std::vector<Entry>& slot = m_slots[(m_currentTick + step) % SlotCount];
+
+        for (size_t i = 0; i < slot.size();)
+        {
+            // due in a later round of the wheel
+            if (slot[i].tick > nowTick)
+            {
+                ++i;
+                continue;
+            }
+
+            // only the most recent deadline of a live socket counts
+            if (auto const socket = slot[i].socket.lock())
+                if (socket->m_deadlineTick == slot[i].tick)
+                    expired.push_back(socket);
+
+            slot[i] = std::move(slot.back());
+            slot.pop_back();
+        }
+    }
+
+    m_currentTick = nowTick;
+}
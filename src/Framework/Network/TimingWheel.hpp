@@ -0,0 +1,70 @@
+/*
+* This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __TIMING_WHEEL_HPP_
+#define __TIMING_WHEEL_HPP_
+
+#include "Platform/Define.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace MaNGOS
+{
+    class Socket;
+
+    // hashed timing wheel holding the deadlines of all sockets of a network thread.
+    // rescheduling does not search for the previous entry, it is simply ignored once its slot comes up.
+    class TimingWheel
+    {
+        public:
+            // resolution of the wheel, in milliseconds
+            static const uint32 TickInterval = 100;
+
+        private:
+            static const size_t SlotCount = 512;
+
+            struct Entry
+            {
+                std::weak_ptr<Socket> socket;
+                uint64 tick;
+            };
+
+            std::mutex m_mutex;
+            std::vector<Entry> m_slots[SlotCount];
+
+            const std::chrono::steady_clock::time_point m_start;
+            uint64 m_currentTick;
+
+        public:
+            TimingWheel();
+
+            TimingWheel(const TimingWheel&) = delete;
+            TimingWheel& operator=(const TimingWheel&) = delete;
+
+            // (re)arms the deadline of the socket, replacing any previous one
+            void Schedule(std::shared_ptr<Socket> const& socket, uint32 milliseconds);
+
+            // moves the wheel up to the current time, collecting the sockets whose deadline has passed
+            void Advance(std::vector<std::shared_ptr<Socket>> &expired);
+    };
+}
+
+#endif /* !__TIMING_WHEEL_HPP_ */
\ No newline at end of file
@@ -0,0 +1,152 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "WorkerPool.h"
+
+namespace MaNGOS
+{
+    WorkerPool::WorkerPool(int threads, Job threadStart, Job threadEnd) : m_threadStart(std::move(threadStart)), m_threadEnd(std::move(threadEnd)), m_nextWorker(0), m_stopping(false), m_queued(0), m_executed(0), m_stolen(0), m_totalWait(0), m_maxWait(0)
+    {
+        for (int i = 0; i < threads; ++i)
+            m_workers.push_back(std::unique_ptr<Worker>(new Worker));
+
+        // the queues have to exist before any worker looks for work to steal
+        for (size_t i = 0; i < m_workers.size(); ++i)
+            m_workers[i]->thread = std::thread(&WorkerPool::Run, this, i);
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+        Stop();
+    }
+
+    void WorkerPool::Post(Job job)
+    {
+        Worker& worker = *m_workers[m_nextWorker++ % m_workers.size()];
+        {
+            std::lock_guard<std::mutex> guard(worker.lock);
+
+            // checked under the queue lock, so that Stop() never leaves a job behind
+            if (m_stopping)
+                return;
+
+            worker.jobs.push_back(QueuedJob { std::move(job), Clock::now() });
+            ++m_queued;
+        }
+
+        // a worker about to sleep has either seen the job or is waiting already
+        {
+            std::lock_guard<std::mutex> guard(m_sleepLock);
+        }
+        m_wakeUp.notify_one();
+    }
+
+    void WorkerPool::Stop()
+    {
+        {
+            std::lock_guard<std::mutex> guard(m_sleepLock);
+            m_stopping = true;
+        }
+        m_wakeUp.notify_all();
+
+        for (auto& worker : m_workers)
+            if (worker->thread.joinable())
+                worker->thread.join();
+
+        // whatever the jobs reference may not outlive the caller
+        for (auto& worker : m_workers)
+        {
+            std::lock_guard<std::mutex> guard(worker->lock);
+            m_queued -= worker->jobs.size();
+            worker->jobs.clear();
+        }
+    }
+
+    WorkerPool::Stats WorkerPool::GetStats() const
+    {
+        Stats stats;
+        stats.queued = m_queued;
+        stats.executed = m_executed;
+        stats.stolen = m_stolen;
+        stats.totalWaitMicroseconds = m_totalWait;
+        stats.maxWaitMicroseconds = m_maxWait;
+        return stats;
+    }
+
+    bool WorkerPool::TakeJob(size_t index, QueuedJob& job)
+    {
+        // oldest of our own jobs first
+        {
+            Worker& own = *m_workers[index];
+            std::lock_guard<std::mutex> guard(own.lock);
+            if (!own.jobs.empty())
+            {
+                job = std::move(own.jobs.front());
+                own.jobs.pop_front();
+                --m_queued;
+                return true;
+            }
+        }
+
+        // then the newest of someone else's, the owner is busy with the oldest ones
+        for (size_t i = 1; i < m_workers.size(); ++i)
+        {
+            Worker& victim = *m_workers[(index + i) % m_workers.size()];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.jobs.empty())
+            {
+                job = std::move(victim.jobs.back());
+                victim.jobs.pop_back();
+                --m_queued;
+                ++m_stolen;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void WorkerPool::Run(size_t index)
+    {
+        if (m_threadStart)
+            m_threadStart();
+
+        while (!m_stopping)
+        {
+            QueuedJob job;
+            if (TakeJob(index, job))
+            {
+                const uint64 wait = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - job.posted).count();
+                m_totalWait += wait;
+
+                uint64 max = m_maxWait;
+                while (wait > max && !m_maxWait.compare_exchange_weak(max, wait)) {}
+
+                job.job();
+                ++m_executed;
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_sleepLock);
+            m_wakeUp.wait(lock, [this] { return m_stopping || m_queued > 0; });
+        }
+
+        if (m_threadEnd)
+            m_threadEnd();
+    }
+}
@@ -0,0 +1,107 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MANGOS_WORKERPOOL_H
+#define MANGOS_WORKERPOOL_H
+
+#include "Platform/Define.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace MaNGOS
+{
+    /// Fixed set of threads running short CPU bound jobs posted from other threads.
+    /// Every worker has its own queue; jobs are spread round robin and an idle worker
+    /// steals from the back of the others' queues before going to sleep.
+    class WorkerPool
+    {
+        public:
+            typedef std::function<void ()> Job;
+
+            struct Stats
+            {
+                uint64 queued;              // jobs waiting right now
+                uint64 executed;
+                uint64 stolen;              // executed by another worker than the one they were posted to
+                uint64 totalWaitMicroseconds;
+                uint64 maxWaitMicroseconds;
+            };
+
+            /// threadStart and threadEnd, when set, run on every worker before its first and after its last job
+            explicit WorkerPool(int threads, Job threadStart = Job(), Job threadEnd = Job());
+            ~WorkerPool();
+
+            /// Runs job on one of the workers, dropped once the pool is stopped
+            void Post(Job job);
+
+            /// Finishes the jobs being executed and destroys the queued ones, later posts are dropped
+            void Stop();
+
+            size_t WorkerCount() const { return m_workers.size(); }
+
+            Stats GetStats() const;
+
+        private:
+            typedef std::chrono::steady_clock Clock;
+
+            struct QueuedJob
+            {
+                Job job;
+                Clock::time_point posted;
+            };
+
+            struct Worker
+            {
+                std::mutex lock;
+                std::deque<QueuedJob> jobs;
+                std::thread thread;
+            };
+
+            WorkerPool(WorkerPool const&) = delete;
+            WorkerPool& operator=(WorkerPool const&) = delete;
+
+            bool TakeJob(size_t index, QueuedJob& job);
+            void Run(size_t index);
+
+            Job m_threadStart;
+            Job m_threadEnd;
+
+            std::vector<std::unique_ptr<Worker>> m_workers;
+            std::atomic<size_t> m_nextWorker;
+
+            std::mutex m_sleepLock;
+            std::condition_variable m_wakeUp;
+            std::atomic<bool> m_stopping;
+
+            std::atomic<uint64> m_queued;
+            std::atomic<uint64> m_executed;
+            std::atomic<uint64> m_stolen;
+            std::atomic<uint64> m_totalWait;
+            std::atomic<uint64> m_maxWait;
+    };
+}
+
+#endif
@@ -0,0 +1,188 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/** \file
+    \ingroup realmd
+*/
+
+#include "AccountCache.h"
+#include "Utilities/Util.h"
+
+std::string UserNameKey(std::string const& login)
+{
+    // user names compare without case in the database
+    std::string key = login;
+    strToUpper(key);
+    return key;
+}
+
+AccountCache::AccountCache() : m_ttl(Clock::duration::zero()), m_shardBudget(0),
+    m_hits(0), m_misses(0), m_evictions(0), m_expirations(0)
+{
+}
+
+AccountCache& AccountCache::Instance()
+{
+    static AccountCache cache;
+    return cache;
+}
+
+void AccountCache::Initialize(uint32 ttl, size_t memoryBudget)
+{
+    if (!ttl || !memoryBudget)
+        return;
+
+    m_ttl = std::chrono::seconds(ttl);
+    m_shardBudget = memoryBudget / ShardCount;
+
+    for (size_t i = 0; i < ShardCount; ++i)
+        m_shards.push_back(std::unique_ptr<Shard>(new Shard));
+}
+
+size_t AccountCache::EntryBytes(Entry const& entry)
+{
+    // the entry, its list and index nodes and the strings it owns
+    AccountRecord const& record = entry.record;
+    return sizeof(Entry) + 4 * sizeof(void*) + sizeof(std::string) + 2 * entry.login.capacity() +
+           record.passHash.capacity() + record.lastIp.capacity() + record.v.capacity() + record.s.capacity() + record.token.capacity();
+}
+
+void AccountCache::Erase(Shard& shard, EntryList::iterator entry)
+{
+    shard.bytes -= entry->bytes;
+    shard.index.erase(entry->login);
+    shard.entries.erase(entry);
+}
+
+bool AccountCache::Find(std::string const& login, AccountRecord& record)
+{
+    if (!IsEnabled())
+        return false;
+
+    std::string const key = UserNameKey(login);
+    Shard& shard = ShardOf(key);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    auto const found = shard.index.find(key);
+    if (found == shard.index.end())
+    {
+        ++m_misses;
+        return false;
+    }
+
+    if (found->second->expires <= Clock::now())
+    {
+        Erase(shard, found->second);
+        ++m_expirations;
+        ++m_misses;
+        return false;
+    }
+
+    shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+    record = found->second->record;
+    ++m_hits;
+    return true;
+}
+
+void AccountCache::Insert(std::string const& login, AccountRecord const& record)
+{
+    if (!IsEnabled())
+        return;
+
+    Entry entry;
+    entry.login = UserNameKey(login);
+    entry.record = record;
+    entry.expires = Clock::now() + m_ttl;
+    entry.bytes = EntryBytes(entry);
+
+    if (entry.bytes > m_shardBudget)
+        return;
+
+    Shard& shard = ShardOf(entry.login);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    auto const found = shard.index.find(entry.login);
+    if (found != shard.index.end())
+        Erase(shard, found->second);
+
+    while (shard.bytes + entry.bytes > m_shardBudget)
+    {
+        Erase(shard, std::prev(shard.entries.end()));
+        ++m_evictions;
+    }
+
+    shard.bytes += entry.bytes;
+    shard.entries.push_front(std::move(entry));
+    shard.index[shard.entries.front().login] = shard.entries.begin();
+}
+
+void AccountCache::Modify(std::string const& login, std::function<void (AccountRecord&)> const& modify)
+{
+    if (!IsEnabled())
+        return;
+
+    std::string const key = UserNameKey(login);
+    Shard& shard = ShardOf(key);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    auto const found = shard.index.find(key);
+    if (found == shard.index.end())
+        return;
+
+    Entry& entry = *found->second;
+    modify(entry.record);
+
+    // the record may have grown, a shard over its budget shrinks at the next insert
+    shard.bytes -= entry.bytes;
+    entry.bytes = EntryBytes(entry);
+    shard.bytes += entry.bytes;
+}
+
+void AccountCache::Invalidate(std::string const& login)
+{
+    if (!IsEnabled())
+        return;
+
+    std::string const key = UserNameKey(login);
+    Shard& shard = ShardOf(key);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    auto const found = shard.index.find(key);
+    if (found != shard.index.end())
+        Erase(shard, found->second);
+}
+
+AccountCache::Stats AccountCache::GetStats() const
+{
+    Stats stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.evictions = m_evictions;
+    stats.expirations = m_expirations;
+    stats.entries = 0;
+    stats.bytes = 0;
+
+    for (auto const& shard : m_shards)
+    {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        stats.entries += shard->entries.size();
+        stats.bytes += shard->bytes;
+    }
+
+    return stats;
+}
@@ -0,0 +1,144 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/// \addtogroup realmd
+/// @{
+/// \file
+
+#ifndef _ACCOUNTCACHE_H
+#define _ACCOUNTCACHE_H
+
+#include "Common.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Key of a user name in the account, name filter and character count caches
+std::string UserNameKey(std::string const& login);
+
+/// The users_account columns read by the logon challenge
+struct AccountRecord
+{
+    std::string passHash;
+    uint32 id;
+    bool locked;
+    std::string lastIp;
+    uint8 securityLevel;
+    std::string v;
+    std::string s;
+    std::string token;
+    bool suspended;
+
+    bool operator==(AccountRecord const& other) const
+    {
+        return passHash == other.passHash && id == other.id && locked == other.locked && lastIp == other.lastIp &&
+               securityLevel == other.securityLevel && v == other.v && s == other.s && token == other.token && suspended == other.suspended;
+    }
+};
+
+/// Recently read account records, so that retried logins skip the database.
+/// Records expire after a few seconds, every shard is an LRU list within its part of the memory
+/// budget.  Changes made by this server are applied to the cached record as they are written.
+class AccountCache
+{
+    public:
+        struct Stats
+        {
+            uint64 hits;
+            uint64 misses;
+            uint64 evictions;                               // dropped to stay within the memory budget
+            uint64 expirations;
+            uint64 entries;
+            uint64 bytes;
+        };
+
+        static AccountCache& Instance();
+
+        AccountCache();
+
+        /// ttl in seconds, a budget of 0 disables the cache
+        void Initialize(uint32 ttl, size_t memoryBudget);
+
+        bool IsEnabled() const { return !m_shards.empty(); }
+
+        /// Copies the record of login into record, false when it is not cached or has expired
+        bool Find(std::string const& login, AccountRecord& record);
+
+        void Insert(std::string const& login, AccountRecord const& record);
+
+        /// Applies an update written to the database to the cached record, if any
+        void Modify(std::string const& login, std::function<void (AccountRecord&)> const& modify);
+
+        /// Forgets login, its next lookup reads the database
+        void Invalidate(std::string const& login);
+
+        Stats GetStats() const;
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        static const size_t ShardCount = 16;
+
+        struct Entry
+        {
+            std::string login;
+            AccountRecord record;
+            Clock::time_point expires;
+            size_t bytes;
+        };
+
+        typedef std::list<Entry> EntryList;
+
+        /// most recently used first
+        struct Shard
+        {
+            std::mutex lock;
+            EntryList entries;
+            std::unordered_map<std::string, EntryList::iterator> index;
+            size_t bytes = 0;
+        };
+
+        AccountCache(AccountCache const&) = delete;
+        AccountCache& operator=(AccountCache const&) = delete;
+
+        static size_t EntryBytes(Entry const& entry);
+
+        Shard& ShardOf(std::string const& key) { return *m_shards[std::hash<std::string>()(key) % m_shards.size()]; }
+        void Erase(Shard& shard, EntryList::iterator entry);
+
+        std::vector<std::unique_ptr<Shard>> m_shards;
+        Clock::duration m_ttl;
+        size_t m_shardBudget;
+
+        std::atomic<uint64> m_hits;
+        std::atomic<uint64> m_misses;
+        std::atomic<uint64> m_evictions;
+        std::atomic<uint64> m_expirations;
+};
+
+#define sAccountCache AccountCache::Instance()
+
+#endif
+/// @}
@@ -0,0 +1,324 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/** \file
+    \ingroup realmd
+*/
+
+#include "AccountNameFilter.h"
+#include "AccountCache.h"
+#include "Database/DatabaseEnv.h"
+#include "Log/Log.h"
+
+#include <cmath>
+
+extern DatabaseType LoginDatabase;
+
+AccountNameFilter::Bloom::Bloom(uint64 capacity) : m_capacity(capacity)
+{
+    // 9.6 bits and 7 hashes per name give a false positive rate of 1%
+    m_words = (capacity * 96 / 10 + 63) / 64;
+    m_bits = m_words * 64;
+    m_data.reset(new std::atomic<uint64>[m_words]());
+}
+
+void AccountNameFilter::Bloom::Hash(std::string const& key, uint64& h1, uint64& h2)
+{
+    // two FNV-1a passes with different offsets, finished by the splitmix64 mixer
+    h1 = 14695981039346656037ULL;
+    h2 = 0x9E3779B97F4A7C15ULL;
+    for (char c : key)
+    {
+        h1 = (h1 ^ uint8(c)) * 1099511628211ULL;
+        h2 = (h2 ^ uint8(c)) * 1099511628211ULL;
+    }
+
+    for (uint64* h : { &h1, &h2 })
+    {
+        *h = (*h ^ (*h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        *h = (*h ^ (*h >> 27)) * 0x94D049BB133111EBULL;
+        *h ^= *h >> 31;
+    }
+
+    // an odd step visits distinct bits
+    h2 |= 1;
+}
+
+void AccountNameFilter::Bloom::Add(std::string const& key)
+{
+    uint64 h1, h2;
+    Hash(key, h1, h2);
+
+    for (int i = 0; i < Hashes; ++i)
+    {
+        uint64 const bit = (h1 + i * h2) % m_bits;
+        m_data[bit / 64].fetch_or(uint64(1) << (bit % 64), std::memory_order_relaxed);
+    }
+}
+
+bool AccountNameFilter::Bloom::Contains(std::string const& key) const
+{
+    uint64 h1, h2;
+    Hash(key, h1, h2);
+
+    for (int i = 0; i < Hashes; ++i)
+    {
+        uint64 const bit = (h1 + i * h2) % m_bits;
+        if (!(m_data[bit / 64].load(std::memory_order_relaxed) & (uint64(1) << (bit % 64))))
+            return false;
+    }
+
+    return true;
+}
+
+double AccountNameFilter::Bloom::FalsePositiveRate(uint64 names) const
+{
+    return std::pow(1.0 - std::exp(-double(Hashes) * double(names) / double(m_bits)), double(Hashes));
+}
+
+AccountNameFilter::AccountNameFilter() : m_negativeShardSize(0), m_refreshInterval(0), m_reloadInterval(0),
+    m_nextRefresh(0), m_nextReload(0), m_lastId(0), m_names(0), m_rejected(0), m_negativeHits(0), m_falsePositives(0)
+{
+}
+
+AccountNameFilter& AccountNameFilter::Instance()
+{
+    static AccountNameFilter filter;
+    return filter;
+}
+
+void AccountNameFilter::Initialize(uint32 refreshInterval, uint32 reloadInterval, size_t negativeCacheSize)
+{
+    if (!refreshInterval)
+        return;
+
+    m_negativeShardSize = negativeCacheSize ? std::max<size_t>(1, negativeCacheSize / NegativeShardCount) : 0;
+
+    if (!Rebuild())
+    {
+        sLog.outError("AccountNameFilter: cannot read the accounts, unknown user names are looked up in the database");
+        return;
+    }
+
+    m_refreshInterval = refreshInterval;
+    m_reloadInterval = reloadInterval;
+    m_nextRefresh = time(nullptr) + m_refreshInterval;
+    m_nextReload = time(nullptr) + m_reloadInterval;
+
+    sLog.outString("Loaded " UI64FMTD " user name(s) into a filter of " UI64FMTD " KB, expected false positive rate %.3f%%",
+                   uint64(m_names), m_writableBloom->Bytes() / 1024, m_writableBloom->FalsePositiveRate(m_names) * 100.0);
+}
+
+void AccountNameFilter::UpdateIfNeed()
+{
+    if (!IsEnabled())
+        return;
+
+    time_t const now = time(nullptr);
+    if (now < m_nextRefresh)
+        return;
+
+    m_nextRefresh = now + m_refreshInterval;
+
+    // past its capacity the false positive rate of the filter climbs quickly.  the polls only see the Ids above
+    // the highest one read, a full rebuild also catches the accounts committed out of order or renamed
+    if (m_names >= m_writableBloom->Capacity() || (m_reloadInterval && now >= m_nextReload))
+    {
+        m_nextReload = now + m_reloadInterval;
+        if (!Rebuild())
+            sLog.outError("AccountNameFilter: cannot rebuild the filter of " UI64FMTD " user name(s)", uint64(m_names));
+        return;
+    }
+
+    uint64 names = 0;
+    Load(*m_writableBloom, m_lastId, names);
+    m_names += names;
+}
+
+bool AccountNameFilter::MayExist(std::string const& login)
+{
+    if (!IsEnabled())
+        return true;
+
+    BloomPtr const bloom = GetBloom();
+    if (!bloom)
+        return true;
+
+    std::string const key = UserNameKey(login);
+    if (!bloom->Contains(key))
+    {
+        ++m_rejected;
+        return false;
+    }
+
+    NegativeShard& shard = NegativeShardOf(key);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    auto const found = shard.entries.find(key);
+    if (found == shard.entries.end() || found->second <= time(nullptr))
+        return true;
+
+    ++m_negativeHits;
+    return false;
+}
+
+void AccountNameFilter::AddMissing(std::string const& login)
+{
+    if (!IsEnabled())
+        return;
+
+    ++m_falsePositives;
+
+    if (!m_negativeShardSize)
+        return;
+
+    std::string const key = UserNameKey(login);
+    time_t const now = time(nullptr);
+
+    NegativeShard& shard = NegativeShardOf(key);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    auto const inserted = shard.entries.insert(std::make_pair(key, now + NegativeTtl));
+    if (!inserted.second)
+    {
+        inserted.first->second = now + NegativeTtl;
+        return;
+    }
+
+    shard.order.push_back(key);
+    shard.bytes += NegativeBytes(key);
+    PruneNegative(shard, now);
+}
+
+void AccountNameFilter::RemoveNegative(std::string const& key)
+{
+    NegativeShard& shard = NegativeShardOf(key);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    auto const found = shard.entries.find(key);
+    if (found != shard.entries.end())
+    {
+        shard.bytes -= NegativeBytes(found->first);
+        shard.entries.erase(found);
+    }
+}
+
+void AccountNameFilter::PruneNegative(NegativeShard& shard, time_t now)
+{
+    while (!shard.order.empty())
+    {
+        std::string const& oldest = shard.order.front();
+        auto const found = shard.entries.find(oldest);
+
+        // a name refreshed by a later lookup stays until the size limit takes it
+        bool const stale = found == shard.entries.end() || found->second <= now;
+        if (!stale && shard.entries.size() <= m_negativeShardSize)
+            break;
+
+        if (found != shard.entries.end())
+        {
+            shard.bytes -= NegativeBytes(found->first);
+            shard.entries.erase(found);
+        }
+        shard.order.pop_front();
+    }
+}
+
+void AccountNameFilter::Load(Bloom& bloom, uint32& lastId, uint64& names)
+{
+    // read in pages by Id, so that a large table is never held by one result
+    for (;;)
+    {
+        QueryResult* result = LoginDatabase.PQuery("SELECT Id, UserName FROM users_account WHERE Id > %u ORDER BY Id LIMIT %u", lastId, PageSize);
+        if (!result)
+            return;                                         // an empty page, or an error the next poll retries
+
+        uint64 const rows = result->GetRowCount();
+
+        do
+        {
+            Field* fields = result->Fetch();
+            lastId = fields[0].GetUInt32();
+
+            std::string const key = UserNameKey(fields[1].GetCppString());
+            bloom.Add(key);
+            ++names;
+
+            // a name remembered as missing may just have been created
+            if (m_negativeShardSize)
+                RemoveNegative(key);
+        }
+        while (result->NextRow());
+
+        delete result;
+
+        if (rows < PageSize)
+            return;
+    }
+}
+
+bool AccountNameFilter::Rebuild()
+{
+    QueryResult* count = LoginDatabase.Query("SELECT COUNT(*), COALESCE(MAX(Id), 0) FROM users_account");
+    if (!count)
+        return false;
+
+    uint64 const accounts = count->Fetch()[0].GetUInt64();
+    uint32 const maxId = count->Fetch()[1].GetUInt32();
+    delete count;
+
+    std::shared_ptr<Bloom> bloom = std::make_shared<Bloom>(std::max(accounts * GrowthFactor, MinCapacity));
+    uint32 lastId = 0;
+    uint64 names = 0;
+    Load(*bloom, lastId, names);
+
+    // a page lost to an error would reject existing accounts, such a filter is never published
+    if (lastId < maxId)
+        return false;
+
+    // lookups keep using the current filter until the new one holds every name, the last of them frees it
+    m_lastId = lastId;
+    m_names = names;
+    m_writableBloom = bloom;
+    std::atomic_store(&m_bloom, BloomPtr(bloom));
+    return true;
+}
+
+AccountNameFilter::Stats AccountNameFilter::GetStats()
+{
+    Stats stats;
+    BloomPtr const bloom = GetBloom();
+
+    stats.names = m_names;
+    stats.filterBytes = bloom ? bloom->Bytes() : 0;
+    stats.expectedFalsePositiveRate = bloom ? bloom->FalsePositiveRate(stats.names) : 0.0;
+    stats.rejected = m_rejected;
+    stats.negativeHits = m_negativeHits;
+    stats.falsePositives = m_falsePositives;
+    stats.negativeEntries = 0;
+    stats.negativeBytes = 0;
+
+    for (NegativeShard& shard : m_negative)
+    {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        stats.negativeEntries += shard.entries.size();
+        stats.negativeBytes += shard.bytes;
+    }
+
+    return stats;
+}
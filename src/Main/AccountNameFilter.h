@@ -0,0 +1,163 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/// \addtogroup realmd
+/// @{
+/// \file
+
+#ifndef _ACCOUNTNAMEFILTER_H
+#define _ACCOUNTNAMEFILTER_H
+
+#include "Common.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/// Tells the logon challenge which user names cannot exist, so that unknown accounts are
+/// answered without a query.  A Bloom filter holds every user name of users_account; the names
+/// it lets through although the database has no such account are remembered in a bounded
+/// negative cache.  Accounts are created outside of this server and are polled by Id.
+class AccountNameFilter
+{
+    public:
+        struct Stats
+        {
+            uint64 names;                                   // added to the filter
+            uint64 filterBytes;
+            uint64 negativeEntries;
+            uint64 negativeBytes;
+            double expectedFalsePositiveRate;               // of the filter at its current load
+            uint64 rejected;                                // lookups answered by the filter
+            uint64 negativeHits;                            // lookups answered by the negative cache
+            uint64 falsePositives;                          // unknown names the filter let through to the database
+        };
+
+        static AccountNameFilter& Instance();
+
+        AccountNameFilter();
+
+        /// Reads every user name.  New accounts are polled every refreshInterval seconds,
+        /// 0 disables the filter: it could not learn about them.  Every reloadInterval seconds the
+        /// whole table is read again, for the accounts the polls cannot see
+        void Initialize(uint32 refreshInterval, uint32 reloadInterval, size_t negativeCacheSize);
+
+        /// Called regularly by the main thread, polls new accounts and rebuilds the filter once it is full or due
+        void UpdateIfNeed();
+
+        bool IsEnabled() const { return m_refreshInterval != 0; }
+
+        /// false when login certainly has no account
+        bool MayExist(std::string const& login);
+
+        /// The database has no account login although MayExist() returned true
+        void AddMissing(std::string const& login);
+
+        Stats GetStats();
+
+    private:
+        /// Bits shared by the readers, names are only ever added
+        class Bloom
+        {
+            public:
+                /// sized for capacity names at a false positive rate of about 1%
+                explicit Bloom(uint64 capacity);
+
+                void Add(std::string const& key);
+                bool Contains(std::string const& key) const;
+
+                uint64 Capacity() const { return m_capacity; }
+                uint64 Bytes() const { return m_words * sizeof(uint64); }
+                double FalsePositiveRate(uint64 names) const;
+
+            private:
+                static const int Hashes = 7;
+
+                static void Hash(std::string const& key, uint64& h1, uint64& h2);
+
+                uint64 m_capacity;
+                uint64 m_bits;
+                uint64 m_words;
+                std::unique_ptr<std::atomic<uint64>[]> m_data;
+        };
+
+        typedef std::shared_ptr<Bloom const> BloomPtr;
+
+        /// Names known to be missing, a lookup only locks the shard of its name
+        struct NegativeShard
+        {
+            std::mutex lock;
+            std::unordered_map<std::string, time_t> entries;    ///< expiry by user name
+            std::deque<std::string> order;                      ///< oldest first, may hold names already dropped from entries
+            uint64 bytes = 0;
+        };
+
+        static const size_t NegativeShardCount = 16;
+
+        // accounts read by one query while building the filter
+        static const uint32 PageSize = 100000;
+
+        // the smallest filter, and the headroom left for new accounts when it is built
+        static const uint64 MinCapacity = 65536;
+        static const uint64 GrowthFactor = 2;
+
+        // an account created while its lookup was answered may be remembered as missing, but not for long
+        static const time_t NegativeTtl = 300;
+
+        AccountNameFilter(AccountNameFilter const&) = delete;
+        AccountNameFilter& operator=(AccountNameFilter const&) = delete;
+
+        static size_t NegativeBytes(std::string const& key) { return 2 * (sizeof(std::string) + key.capacity()) + sizeof(time_t) + 4 * sizeof(void*); }
+
+        /// Adds the accounts with an Id above lastId to bloom and advances lastId
+        void Load(Bloom& bloom, uint32& lastId, uint64& names);
+        /// Builds a filter sized for the current accounts and publishes it, false when they cannot be counted
+        bool Rebuild();
+        BloomPtr GetBloom() const { return std::atomic_load(&m_bloom); }
+
+        NegativeShard& NegativeShardOf(std::string const& key) { return m_negative[std::hash<std::string>()(key) % NegativeShardCount]; }
+        /// Forgets key if it is remembered as missing
+        void RemoveNegative(std::string const& key);
+        /// Drops the oldest entries of the shard beyond its size limit or past their expiry, its lock held
+        void PruneNegative(NegativeShard& shard, time_t now);
+
+        BloomPtr m_bloom;                                   ///< only accessed through std::atomic_load and std::atomic_store
+        std::shared_ptr<Bloom> m_writableBloom;             ///< the published filter, new accounts are added to it by the main thread
+
+        NegativeShard m_negative[NegativeShardCount];
+        size_t m_negativeShardSize;
+
+        uint32 m_refreshInterval;
+        uint32 m_reloadInterval;
+        time_t m_nextRefresh;
+        time_t m_nextReload;
+        uint32 m_lastId;
+
+        std::atomic<uint64> m_names;
+        std::atomic<uint64> m_rejected;
+        std::atomic<uint64> m_negativeHits;
+        std::atomic<uint64> m_falsePositives;
+};
+
+#define sAccountNameFilter AccountNameFilter::Instance()
+
+#endif
+/// @}
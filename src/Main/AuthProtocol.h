@@ -0,0 +1,164 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/** \file
+    \ingroup realmd
+    Wire format of the messages exchanged between the client and the authentication server
+*/
+
+#ifndef _AUTHPROTOCOL_H
+#define _AUTHPROTOCOL_H
+
+#include "Platform/Define.h"
+
+#include <openssl/md5.h>
+
+enum AccountFlags
+{
+    ACCOUNT_FLAG_GM         = 0x00000001,
+    ACCOUNT_FLAG_TRIAL      = 0x00000008,
+    ACCOUNT_FLAG_PROPASS    = 0x00800000,
+};
+
+enum SecurityFlags
+{
+    SECURITY_FLAG_NONE          = 0x00,
+    SECURITY_FLAG_PIN           = 0x01,
+    SECURITY_FLAG_UNK           = 0x02,
+    SECURITY_FLAG_AUTHENTICATOR = 0x04
+};
+
+// GCC have alternative #pragma pack(N) syntax and old gcc version not support pack(push,N), also any gcc version not support it at some paltform
+#if defined( __GNUC__ )
+#pragma pack(1)
+#else
+#pragma pack(push,1)
+#endif
+
+typedef struct AUTH_LOGON_CHALLENGE_C
+{
+    uint8   cmd;
+    uint8   error;
+    uint16  size;
+    uint8   gamename[4];
+    uint8   version1;
+    uint8   version2;
+    uint8   version3;
+    uint16  build;
+    uint8   platform[4];
+    uint8   os[4];
+    uint8   country[4];
+    uint32  timezone_bias;
+    uint32  ip;
+    uint8   I_len;
+    uint8   I[1];
+} sAuthLogonChallenge_C;
+
+typedef struct AUTH_LOGON_PIN_DATA_C
+{
+    uint8 salt[16];
+    uint8 hash[20];
+} sAuthLogonPinData_C;
+
+typedef struct AUTH_LOGON_AUTHENTICATOR_DATA_C
+{
+    uint8 unk; // Has to be 0x01
+    uint8 keys[6]; // Valid code must be 6 digits
+} sAuthLogonAuthenticatorData_C;
+
+// typedef sAuthLogonChallenge_C sAuthReconnectChallenge_C;
+/*
+typedef struct
+{
+    uint8   cmd;
+    uint8   error;
+    uint8   unk2;
+    uint8   B[32];
+    uint8   g_len;
+    uint8   g[1];
+    uint8   N_len;
+    uint8   N[32];
+    uint8   s[32];
+    uint8   unk3[16];
+} sAuthLogonChallenge_S;
+*/
+
+typedef struct AUTH_LOGON_PROOF_C
+{
+    uint8   cmd;
+    uint8   A[32];
+    uint8   M1[20];
+    uint8   crc_hash[20];
+    uint8   number_of_keys;
+    uint8   securityFlags;                                  // 0x00-0x04
+} sAuthLogonProof_C;
+/*
+typedef struct
+{
+    uint16  unk1;
+    uint32  unk2;
+    uint8   unk3[4];
+    uint16  unk4[20];
+}  sAuthLogonProofKey_C;
+*/
+typedef struct AUTH_LOGON_PROOF_S
+{
+    uint8   cmd;
+    uint8   error;
+    uint8   M2[20];
+    uint32  accountFlags;                                   // see enum AccountFlags
+    uint32  surveyId;                                       // SurveyId
+    uint16  unkFlags;                                       // some flags (AccountMsgAvailable = 0x01)
+} sAuthLogonProof_S;
+
+typedef struct AUTH_LOGON_PROOF_S_BUILD_6005
+{
+    uint8   cmd;
+    uint8   error;
+    uint8   M2[20];
+    // uint32  unk1;
+    uint32  unk2;
+    // uint16  unk3;
+} sAuthLogonProof_S_BUILD_6005;
+
+typedef struct AUTH_RECONNECT_PROOF_C
+{
+    uint8   cmd;
+    uint8   R1[16];
+    uint8   R2[20];
+    uint8   R3[20];
+    uint8   number_of_keys;
+} sAuthReconnectProof_C;
+
+typedef struct XFER_INIT
+{
+    uint8 cmd;                                              // XFER_INITIATE
+    uint8 fileNameLen;                                      // strlen(fileName);
+    uint8 fileName[5];                                      // fileName[fileNameLen]
+    uint64 file_size;                                       // file size (bytes)
+    uint8 md5[MD5_DIGEST_LENGTH];                           // MD5
+} XFER_INIT;
+
+// GCC have alternative #pragma pack() syntax and old gcc version not support pack(pop), also any gcc version not support it at some paltform
+#if defined( __GNUC__ )
+#pragma pack()
+#else
+#pragma pack(pop)
+#endif
+
+#endif
@@ -23,36 +23,31 @@
 #include "Common.h"
 #include "Auth/HMACSHA1.h"
 #include "Auth/base32.h"
+#include "Auth/SRP6Params.h"
+#include "Auth/Sha1Batch.h"
+#include "Threading/WorkerPool.h"
 #include "Database/DatabaseEnv.h"
 #include "Config/Config.h"
 #include "Log/Log.h"
 #include "RealmList.h"
 #include "AuthSocket.h"
+#include "BanCache.h"
+#include "AccountCache.h"
+#include "AccountNameFilter.h"
+#include "CharacterCountCache.h"
 #include "AuthCodes.h"
+#include "AuthProtocol.h"
 
 #include <openssl/md5.h>
 #include <ctime>
 #include <assert.h>
+#include <deque>
+#include <mutex>
 
 //#include "Util.h" -- for commented utf8ToUpperOnlyLatin
 
 extern DatabaseType LoginDatabase;
 
-enum AccountFlags
-{
-    ACCOUNT_FLAG_GM         = 0x00000001,
-    ACCOUNT_FLAG_TRIAL      = 0x00000008,
-    ACCOUNT_FLAG_PROPASS    = 0x00800000,
-};
-
-enum SecurityFlags
-{
-    SECURITY_FLAG_NONE          = 0x00,
-    SECURITY_FLAG_PIN           = 0x01,
-    SECURITY_FLAG_UNK           = 0x02,
-    SECURITY_FLAG_AUTHENTICATOR = 0x04
-};
-
 // GCC have alternative #pragma pack(N) syntax and old gcc version not support pack(push,N), also any gcc version not support it at some paltform
 #if defined( __GNUC__ )
 #pragma pack(1)
@@ -60,110 +55,6 @@ enum SecurityFlags
 #pragma pack(push,1)
 #endif
 
-typedef struct AUTH_LOGON_CHALLENGE_C
-{
-    uint8   cmd;
-    uint8   error;
-    uint16  size;
-    uint8   gamename[4];
-    uint8   version1;
-    uint8   version2;
-    uint8   version3;
-    uint16  build;
-    uint8   platform[4];
-    uint8   os[4];
-    uint8   country[4];
-    uint32  timezone_bias;
-    uint32  ip;
-    uint8   I_len;
-    uint8   I[1];
-} sAuthLogonChallenge_C;
-
-typedef struct AUTH_LOGON_PIN_DATA_C
-{
-    uint8 salt[16];
-    uint8 hash[20];
-} sAuthLogonPinData_C;
-
-typedef struct AUTH_LOGON_AUTHENTICATOR_DATA_C
-{
-    uint8 unk; // Has to be 0x01
-    uint8 keys[6]; // Valid code must be 6 digits
-} sAuthLogonAuthenticatorData_C;
-
-// typedef sAuthLogonChallenge_C sAuthReconnectChallenge_C;
-/*
-typedef struct
-{
-    uint8   cmd;
-    uint8   error;
-    uint8   unk2;
-    uint8   B[32];
-    uint8   g_len;
-    uint8   g[1];
-    uint8   N_len;
-    uint8   N[32];
-    uint8   s[32];
-    uint8   unk3[16];
-} sAuthLogonChallenge_S;
-*/
-
-typedef struct AUTH_LOGON_PROOF_C
-{
-    uint8   cmd;
-    uint8   A[32];
-    uint8   M1[20];
-    uint8   crc_hash[20];
-    uint8   number_of_keys;
-    uint8   securityFlags;                                  // 0x00-0x04
-} sAuthLogonProof_C;
-/*
-typedef struct
-{
-    uint16  unk1;
-    uint32  unk2;
-    uint8   unk3[4];
-    uint16  unk4[20];
-}  sAuthLogonProofKey_C;
-*/
-typedef struct AUTH_LOGON_PROOF_S
-{
-    uint8   cmd;
-    uint8   error;
-    uint8   M2[20];
-    uint32  accountFlags;                                   // see enum AccountFlags
-    uint32  surveyId;                                       // SurveyId
-    uint16  unkFlags;                                       // some flags (AccountMsgAvailable = 0x01)
-} sAuthLogonProof_S;
-
-typedef struct AUTH_LOGON_PROOF_S_BUILD_6005
-{
-    uint8   cmd;
-    uint8   error;
-    uint8   M2[20];
-    // uint32  unk1;
-    uint32  unk2;
-    // uint16  unk3;
-} sAuthLogonProof_S_BUILD_6005;
-
-typedef struct AUTH_RECONNECT_PROOF_C
-{
-    uint8   cmd;
-    uint8   R1[16];
-    uint8   R2[20];
-    uint8   R3[20];
-    uint8   number_of_keys;
-} sAuthReconnectProof_C;
-
-typedef struct XFER_INIT
-{
-    uint8 cmd;                                              // XFER_INITIATE
-    uint8 fileNameLen;                                      // strlen(fileName);
-    uint8 fileName[5];                                      // fileName[fileNameLen]
-    uint64 file_size;                                       // file size (bytes)
-    uint8 md5[MD5_DIGEST_LENGTH];                           // MD5
-} XFER_INIT;
-
 typedef struct AuthHandler
 {
     eAuthCmd cmd;
@@ -178,12 +69,318 @@ typedef struct AuthHandler
 #pragma pack(pop)
 #endif
 
-/// Constructor - set the N and g values for SRP6
-AuthSocket::AuthSocket(boost::asio::io_service& service, std::function<void (Socket*)> closeHandler)
-    : Socket(service, closeHandler), _status(STATUS_CHALLENGE), _build(0), _accountSecurityLevel(SEC_PLAYER)
+/// Constructor - the SRP6 group (N and g) is shared, see SRP6Params
+AuthSocket::AuthSocket(boost::asio::io_service& service, std::function<void (Socket*)> closeHandler, MaNGOS::PacketBufferPool& bufferPool, MaNGOS::TimingWheel& timingWheel)
+    : Socket(service, closeHandler, bufferPool, timingWheel), _status(STATUS_CHALLENGE), _build(0), _accountSecurityLevel(SEC_PLAYER)
+{
+}
+
+uint32 AuthSocket::s_challengeTimeout = 0;
+uint32 AuthSocket::s_proofTimeout = 0;
+uint32 AuthSocket::s_realmListTimeout = 0;
+uint32 AuthSocket::s_sessionTimeout = 0;
+
+MaNGOS::WorkerPool* AuthSocket::s_cryptoPool = nullptr;
+
+namespace
+{
+    /// The account of login and the unban date of its active ban, one round trip for the logon challenge
+    std::string AccountLookupSql(std::string const& login)
+    {
+        std::string safeLogin = login;
+        LoginDatabase.escape_string(safeLogin);
+
+        return "SELECT ShaPassHash,Id,Locked,LastIp,SecurityLevel,V,S,Token,Suspended FROM users_account WHERE UserName = '" + safeLogin + "';"
+               "SELECT ab.unbandate FROM banned_account ab JOIN users_account a ON a.Id = ab.id "
+               "WHERE a.UserName = '" + safeLogin + "' AND ab.unbandate > UNIX_TIMESTAMP() ORDER BY ab.unbandate DESC LIMIT 1";
+    }
+
+    /// Fills account from the results of AccountLookupSql(), false without account.  The ban cache may not
+    /// have polled a ban given elsewhere yet, one found here is added to it
+    bool ReadAccountLookup(QueryResultList const& results, AccountRecord& account)
+    {
+        if (results.empty() || !results[0])
+            return false;
+
+        Field* fields = results[0]->Fetch();
+        account.passHash = fields[0].GetCppString();
+        account.id = fields[1].GetUInt32();
+        account.locked = fields[2].GetUInt8() == 1;
+        account.lastIp = fields[3].GetCppString();
+        account.securityLevel = fields[4].GetUInt8();
+        account.v = fields[5].GetCppString();
+        account.s = fields[6].GetCppString();
+        account.token = fields[7].GetCppString();
+        account.suspended = fields[8].GetUInt8() == 1;
+
+        if (results.size() > 1 && results[1])
+            sBanCache.AddAccountBan(account.id, time_t(results[1]->Fetch()[0].GetUInt64()));
+
+        return true;
+    }
+
+    /// length of a little endian number as UpdateBigNumbers hashes it, without the zero top bytes
+    int Significant(uint8 const* bytes, int length)
+    {
+        while (length && !bytes[length - 1])
+            --length;
+        return length;
+    }
+
+    /// The logon proof from S = (A * v^u) ^ b to the proofs M and M2, computed from copies so it can run on any thread
+    struct LogonProofMath
+    {
+        static const int MaxBatch = Sha1Batch::MaxLanes;
+        static const int MaxMessage = 20 + 20 + 32 + 32 + 32 + 40;  // H(N)^H(g), H(I), s, A, B, K
+
+        sAuthLogonProof_C proof;
+        uint8 v[Mont256::Bytes];
+        int vLength;
+        uint8 u[SHA_DIGEST_LENGTH];
+        uint8 b[Mont256::Bytes];
+        int bLength;
+        uint8 s[Mont256::Bytes];
+        int sLength;
+        uint8 B[Mont256::Bytes];
+        int BLength;
+        uint8 loginHash[SHA_DIGEST_LENGTH];
+
+        uint8 S[Mont256::Bytes];
+        uint8 K[40];                                        ///< session key
+        uint8 M[SHA_DIGEST_LENGTH];                         ///< expected client proof
+        uint8 M2[SHA_DIGEST_LENGTH];                        ///< server proof
+
+        bool Load(sAuthLogonProof_C const& lp, BigNumber const& verifier, uint8 const* digest, BigNumber const& secret,
+                  BigNumber const& salt, BigNumber const& publicB, std::string const& login)
+        {
+            proof = lp;
+            vLength = verifier.GetNumBytes();
+            bLength = secret.GetNumBytes();
+            sLength = salt.GetNumBytes();
+            BLength = publicB.GetNumBytes();
+            memcpy(u, digest, SHA_DIGEST_LENGTH);
+
+            Sha1Hash sha;
+            sha.UpdateData(login);
+            sha.Finalize();
+            memcpy(loginHash, sha.GetDigest(), SHA_DIGEST_LENGTH);
+
+            return verifier.WriteBytes(v, Mont256::Bytes) && secret.WriteBytes(b, Mont256::Bytes) &&
+                   salt.WriteBytes(s, Mont256::Bytes) && publicB.WriteBytes(B, Mont256::Bytes);
+        }
+
+        void ComputeS()
+        {
+            Mont256 const& mont = sSRP6Params.GetMont256();
+            Mont256::Element montA, montS;
+
+            mont.FromBytes(montA, proof.A, 32);
+            mont.FromBytes(montS, v, vLength);
+            mont.ModExp(montS, montS, u, SHA_DIGEST_LENGTH);
+            mont.Mul(montS, montA, montS);
+            mont.ModExp(montS, montS, b, bLength);
+            mont.ToBytes(S, montS);
+        }
+
+        /// Up to MaxBatch proofs, the hashes of all of them go through Sha1Batch together
+        static void Compute(LogonProofMath* const* maths, int count)
+        {
+            uint8 messages[MaxBatch * 2][MaxMessage];
+            uint8 const* pointers[MaxBatch * 2];
+            int lengths[MaxBatch * 2];
+            uint8 digests[MaxBatch * 2 * SHA_DIGEST_LENGTH];
+
+            for (int i = 0; i < MaxBatch * 2; ++i)
+                pointers[i] = messages[i];
+
+            ///- K interleaves the hashes of the even and of the odd bytes of S
+            for (int i = 0; i < count; ++i)
+            {
+                maths[i]->ComputeS();
+                for (int j = 0; j < 16; ++j)
+                {
+                    messages[i * 2][j] = maths[i]->S[j * 2];
+                    messages[i * 2 + 1][j] = maths[i]->S[j * 2 + 1];
+                }
+                lengths[i * 2] = lengths[i * 2 + 1] = 16;
+            }
+
+            Sha1Batch::Hash(pointers, lengths, count * 2, digests);
+
+            for (int i = 0; i < count; ++i)
+            {
+                uint8 const* even = digests + i * 2 * SHA_DIGEST_LENGTH;
+                uint8 const* odd = even + SHA_DIGEST_LENGTH;
+                for (int j = 0; j < SHA_DIGEST_LENGTH; ++j)
+                {
+                    maths[i]->K[j * 2] = even[j];
+                    maths[i]->K[j * 2 + 1] = odd[j];
+                }
+            }
+
+            ///- M = H(H(N) ^ H(g), H(I), s, A, B, K)
+            for (int i = 0; i < count; ++i)
+            {
+                LogonProofMath const& math = *maths[i];
+                uint8* message = messages[i];
+                int length = 0;
+
+                Append(message, length, sSRP6Params.GetNgHash(), sSRP6Params.GetNgHashLength());
+                Append(message, length, math.loginHash, SHA_DIGEST_LENGTH);
+                Append(message, length, math.s, math.sLength);
+                Append(message, length, math.proof.A, Significant(math.proof.A, 32));
+                Append(message, length, math.B, math.BLength);
+                Append(message, length, math.K, Significant(math.K, 40));
+                lengths[i] = length;
+            }
+
+            Sha1Batch::Hash(pointers, lengths, count, digests);
+
+            ///- M2 = H(A, M, K)
+            for (int i = 0; i < count; ++i)
+            {
+                LogonProofMath& math = *maths[i];
+                memcpy(math.M, digests + i * SHA_DIGEST_LENGTH, SHA_DIGEST_LENGTH);
+
+                uint8* message = messages[i];
+                int length = 0;
+
+                Append(message, length, math.proof.A, Significant(math.proof.A, 32));
+                Append(message, length, math.M, Significant(math.M, SHA_DIGEST_LENGTH));
+                Append(message, length, math.K, Significant(math.K, 40));
+                lengths[i] = length;
+            }
+
+            Sha1Batch::Hash(pointers, lengths, count, digests);
+
+            for (int i = 0; i < count; ++i)
+                memcpy(maths[i]->M2, digests + i * SHA_DIGEST_LENGTH, SHA_DIGEST_LENGTH);
+        }
+
+        static void Append(uint8* message, int& length, uint8 const* data, int size)
+        {
+            memcpy(message + length, data, size);
+            length += size;
+        }
+    };
+
+    /// Logon proofs waiting for the crypto pool.  Every proof posts one job, the first job to run
+    /// takes up to MaxBatch waiting proofs so the hashes of concurrent logins are computed together,
+    /// the jobs finding nothing left return at once.
+    class LogonProofQueue
+    {
+        public:
+            typedef std::function<void ()> Completion;
+
+            void Submit(MaNGOS::WorkerPool& pool, std::shared_ptr<LogonProofMath> math, Completion completion)
+            {
+                {
+                    std::lock_guard<std::mutex> guard(m_lock);
+                    m_pending.push_back(Pending{std::move(math), std::move(completion)});
+                }
+
+                pool.Post([this] () { Run(); });
+            }
+
+        private:
+            struct Pending
+            {
+                std::shared_ptr<LogonProofMath> math;
+                Completion completion;
+            };
+
+            void Run()
+            {
+                Pending batch[LogonProofMath::MaxBatch];
+                int count = 0;
+
+                {
+                    std::lock_guard<std::mutex> guard(m_lock);
+                    while (count < LogonProofMath::MaxBatch && !m_pending.empty())
+                    {
+                        batch[count++] = std::move(m_pending.front());
+                        m_pending.pop_front();
+                    }
+                }
+
+                if (!count)
+                    return;
+
+                LogonProofMath* maths[LogonProofMath::MaxBatch];
+                for (int i = 0; i < count; ++i)
+                    maths[i] = batch[i].math.get();
+
+                LogonProofMath::Compute(maths, count);
+
+                for (int i = 0; i < count; ++i)
+                    batch[i].completion();
+            }
+
+            std::mutex m_lock;
+            std::deque<Pending> m_pending;
+    };
+
+    LogonProofQueue s_logonProofQueue;
+}
+
+void AuthSocket::LoadTimeouts()
 {
-    N.SetHexStr("894B645E89E1535BBDAD5B8B290650530801B18EBFBF5E8FAB3C82872A3E9BB7");
-    g.SetDword(7);
+    s_challengeTimeout = std::max(sConfig.GetIntDefault("Timeout.Challenge", 15), 0) * IN_MILLISECONDS;
+    s_proofTimeout = std::max(sConfig.GetIntDefault("Timeout.Proof", 15), 0) * IN_MILLISECONDS;
+    s_realmListTimeout = std::max(sConfig.GetIntDefault("Timeout.RealmList", 60), 0) * IN_MILLISECONDS;
+    s_sessionTimeout = std::max(sConfig.GetIntDefault("Timeout.Session", 0), 0) * IN_MILLISECONDS;
+}
+
+bool AuthSocket::Open()
+{
+    if (!Socket::Open())
+        return false;
+
+    if (s_sessionTimeout)
+        _sessionEnd = std::chrono::steady_clock::now() + std::chrono::milliseconds(s_sessionTimeout);
+
+    UpdateDeadline();
+    return true;
+}
+
+void AuthSocket::SetStatus(eStatus status)
+{
+    _status = status;
+    UpdateDeadline();
+}
+
+/// Arm the deadline of the current state, never past the end of the session
+void AuthSocket::UpdateDeadline()
+{
+    uint32 timeout = 0;
+
+    switch (_status)
+    {
+        case STATUS_CHALLENGE:
+        case STATUS_CLOSED:
+            timeout = s_challengeTimeout;
+            break;
+        case STATUS_LOGON_PROOF:
+        case STATUS_RECON_PROOF:
+            timeout = s_proofTimeout;
+            break;
+        case STATUS_AUTHED:
+            timeout = s_realmListTimeout;
+            break;
+        case STATUS_PATCH:
+            break;
+    }
+
+    if (s_sessionTimeout)
+    {
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(_sessionEnd - std::chrono::steady_clock::now()).count();
+        const uint32 sessionLeft = left > 0 ? uint32(left) : 1;
+
+        if (!timeout || sessionLeft < timeout)
+            timeout = sessionLeft;
+    }
+
+    SetDeadline(timeout);
 }
 
 /// Read the packet from the client
@@ -206,9 +403,10 @@ bool AuthSocket::ProcessIncomingData()
 
     // the purpose of this loop is to handle multiple opcodes in the same tcp packet,
     // which presumably the client will never do, but lets support it anyway! \o/
-    while (ReadLengthRemaining() > 0)
+    // a handler waiting for the database or the crypto pool leaves the rest for later
+    while (!IsIncomingSuspended() && ReadLengthRemaining() > 0)
     {
-        const eAuthCmd cmd = static_cast<eAuthCmd>(*InPeak());
+        const eAuthCmd cmd = static_cast<eAuthCmd>(InPeak());
         int i;
 
         ///- Circle through known commands and call the correct command handler
@@ -250,39 +448,73 @@ bool AuthSocket::ProcessIncomingData()
     return true;
 }
 
+void AuthSocket::SuspendForQuery(SqlStatement& stmt, std::function<bool (QueryResult*)> continuation)
+{
+    // the socket stays alive until the continuation ran, the result until both are gone
+    std::shared_ptr<AuthSocket> self = shared<AuthSocket>();
+    SuspendIncoming();
+    stmt.AsyncQuery([self, continuation] (QueryResult* result, bool failed)
+    {
+        std::shared_ptr<QueryResult> owned(result);
+        self->ResumeIncoming([self, owned, failed, continuation] ()
+        {
+            // an error is not an empty result, the client is dropped rather than told its account does not exist
+            if (failed)
+            {
+                sLog.outError("[Auth] database error while handling %s, closing the connection", self->_login.c_str());
+                return false;
+            }
+
+            return continuation(owned.get());
+        });
+    });
+}
+
+void AuthSocket::SuspendForQuery(std::string const& sql, std::function<bool (QueryResultList const&)> continuation)
+{
+    std::shared_ptr<AuthSocket> self = shared<AuthSocket>();
+    SuspendIncoming();
+    LoginDatabase.AsyncQueryMulti(sql, [self, continuation] (QueryResultList& results, bool failed)
+    {
+        std::shared_ptr<QueryResultList> owned(new QueryResultList(std::move(results)), [] (QueryResultList* list)
+        {
+            for (QueryResult* result : *list)
+                delete result;
+            delete list;
+        });
+
+        self->ResumeIncoming([self, owned, failed, continuation] ()
+        {
+            if (failed)
+            {
+                sLog.outError("[Auth] database error while handling %s, closing the connection", self->_login.c_str());
+                return false;
+            }
+
+            return continuation(*owned);
+        });
+    });
+}
+
 /// Make the SRP6 calculation from hash in dB
 void AuthSocket::_SetVSFields(const std::string& rI)
 {
-    s.SetRand(s_BYTE_SIZE * 8);
-
-    BigNumber I;
-    I.SetHexStr(rI.c_str());
+    sSRP6Params.MakeVerifier(rI, s, v);
 
-    // In case of leading zeros in the rI hash, restore them
-    uint8 mDigest[SHA_DIGEST_LENGTH];
-    memset(mDigest, 0, SHA_DIGEST_LENGTH);
-    if (I.GetNumBytes() <= SHA_DIGEST_LENGTH)
-        memcpy(mDigest, I.AsByteArray(), I.GetNumBytes());
+    // both are below N
+    char v_hex[s_BYTE_SIZE * 2 + 1];
+    char s_hex[s_BYTE_SIZE * 2 + 1];
+    v.WriteHexStr(v_hex, sizeof(v_hex));
+    s.WriteHexStr(s_hex, sizeof(s_hex));
 
-    std::reverse(mDigest, mDigest + SHA_DIGEST_LENGTH);
+    static SqlStatementID updateVS;
+    SqlStatement stmt = LoginDatabase.CreateStatement(updateVS, "UPDATE users_account SET V = ?, S = ? WHERE UserName = ?");
+    stmt.PExecute(v_hex, s_hex, _login.c_str());
 
-    Sha1Hash sha;
-    sha.UpdateData(s.AsByteArray(), s.GetNumBytes());
-    sha.UpdateData(mDigest, SHA_DIGEST_LENGTH);
-    sha.Finalize();
-    BigNumber x;
-    x.SetBinary(sha.GetDigest(), sha.GetLength());
-    v = g.ModExp(x, N);
-    // No SQL injection (username escaped)
-    const char* v_hex, *s_hex;
-    v_hex = v.AsHexStr();
-    s_hex = s.AsHexStr();
-    LoginDatabase.PExecute("UPDATE account SET v = '%s', s = '%s' WHERE username = '%s'", v_hex, s_hex, _safelogin.c_str());
-    OPENSSL_free((void*)v_hex);
-    OPENSSL_free((void*)s_hex);
+    sAccountCache.Modify(_login, [&v_hex, &s_hex] (AccountRecord& account) { account.v = v_hex; account.s = s_hex; });
 }
 
-void AuthSocket::SendProof(Sha1Hash sha)
+void AuthSocket::SendProof(uint8 const* M2)
 {
     switch (_build)
     {
@@ -291,7 +523,7 @@ void AuthSocket::SendProof(Sha1Hash sha)
         case 6141:                                          // 1.12.3
         {
             sAuthLogonProof_S_BUILD_6005 proof{};
-            memcpy(proof.M2, sha.GetDigest(), 20);
+            memcpy(proof.M2, M2, 20);
             proof.cmd = CMD_AUTH_LOGON_PROOF;
             proof.error = 0;
             proof.unk2 = 0x00;
@@ -308,7 +540,7 @@ void AuthSocket::SendProof(Sha1Hash sha)
         default:                                            // or later
         {
             sAuthLogonProof_S proof{};
-            memcpy(proof.M2, sha.GetDigest(), 20);
+            memcpy(proof.M2, M2, 20);
             proof.cmd = CMD_AUTH_LOGON_PROOF;
             proof.error = 0;
             proof.accountFlags = ACCOUNT_FLAG_PROPASS;
@@ -343,7 +575,7 @@ bool AuthSocket::_HandleLogonChallenge()
         return false;
 
     ///- Session is closed unless overriden
-    _status = STATUS_CLOSED;
+    SetStatus(STATUS_CLOSED);
 
     // No big fear of memory outage (size is int16, i.e. < 65536)
     buf.resize(remaining + buf.size() + 1);
@@ -365,166 +597,187 @@ bool AuthSocket::_HandleLogonChallenge()
     EndianConvert(ch->timezone_bias);
     EndianConvert(ch->ip);
 
-    ByteBuffer pkt;
-
     _login = (const char*)ch->I;
     _build = ch->build;
 
     ///- Normalize account name
     // utf8ToUpperOnlyLatin(_login); -- client already send account in expected form
 
-    // Escape the user login to avoid further SQL injection
-    // Memory will be freed on AuthSocket object destruction
-    _safelogin = _login;
-    LoginDatabase.escape_string(_safelogin);
+    _localizationName.resize(4);
+    for (int i = 0; i < 4; ++i)
+        _localizationName[i] = ch->country[4 - i - 1];
 
-    pkt << (uint8) CMD_AUTH_LOGON_CHALLENGE;
-    pkt << (uint8) 0x00;
+    ///- Verify that this IP is not banned, without asking the database
+    if (sBanCache.IsIpBanned(m_address))
+    {
+        ByteBuffer pkt;
+        pkt << (uint8) CMD_AUTH_LOGON_CHALLENGE;
+        pkt << (uint8) 0x00;
+        pkt << (uint8) WOW_FAIL_BANNED;
+        BASIC_LOG("[AuthChallenge] Banned ip %s tries to login!", m_address.c_str());
 
-    ///- Verify that this IP is not in the ip_banned table
-    // No SQL injection possible (paste the IP address as passed by the socket)
-    std::unique_ptr<QueryResult> ip_banned_result(LoginDatabase.PQuery("SELECT UnBanDate FROM banned_ip "
-            "WHERE UnBanDate > UNIX_TIMESTAMP() AND ip = '%s'", m_address.c_str()));
+        Write((const char*)pkt.contents(), pkt.size());
+        return true;
+    }
 
-    std::unique_ptr<QueryResult> account_banned_result(LoginDatabase.PQuery(
-        "SELECT ab.unbandate FROM banned_account ab LEFT JOIN users_account a ON a.id = ab.id "
-        "WHERE a.UserName = '%s' AND (ab.unbandate > UNIX_TIMESTAMP())", _safelogin.c_str()));
+    ///- Unknown user names are answered without a query
+    if (!sAccountNameFilter.MayExist(_login))
+        return _FinishLogonChallenge(nullptr);
 
-    if (ip_banned_result)
+    ///- Retried logins find the account details in the cache
+    AccountRecord account;
+    if (sAccountCache.Find(_login, account))
     {
-        pkt << (uint8)WOW_FAIL_BANNED;
-        BASIC_LOG("[AuthChallenge] Banned ip %s tries to login!", m_address.c_str());
+        _cachedAccount = std::make_shared<AccountRecord>(account);
+        return _FinishLogonChallenge(&account);
     }
-    else if (account_banned_result)
+
+    _cachedAccount.reset();
+
+    ///- Get the account details and its ban from the database in one round trip
+    SuspendForQuery(AccountLookupSql(_login), [this] (QueryResultList const& results)
+    {
+        AccountRecord account;
+        if (!ReadAccountLookup(results, account))
+        {
+            // the query succeeded without a row, errors never reach here
+            sAccountNameFilter.AddMissing(_login);
+            return _FinishLogonChallenge(nullptr);
+        }
+
+        sAccountCache.Insert(_login, account);
+        return _FinishLogonChallenge(&account);
+    });
+    return true;
+}
+
+/// Second half of the logon challenge, once the account is known (nullptr without account)
+bool AuthSocket::_FinishLogonChallenge(AccountRecord const* account)
+{
+    ByteBuffer pkt;
+    pkt << (uint8) CMD_AUTH_LOGON_CHALLENGE;
+    pkt << (uint8) 0x00;
+
+    if (account && sBanCache.IsAccountBanned(account->id))
     {
         pkt << (uint8)WOW_FAIL_BANNED;
-        BASIC_LOG("[AuthChallenge] Banned account %s tries to login!", _safelogin.c_str());
+        BASIC_LOG("[AuthChallenge] Banned account %s tries to login!", _login.c_str());
     }
-    else
+    else if (account)
     {
-        ///- Get the account details from the account table
-        // No SQL injection (escaped user name)
-
-        //                                                 0           1  2      3      4             5 6 7     8
-        QueryResult* result = LoginDatabase.PQuery("SELECT ShaPassHash,Id,Locked,LastIp,SecurityLevel,V,S,Token,Suspended FROM users_account WHERE UserName = '%s'", _safelogin.c_str());
-        if (result)
+        ///- If the IP is 'locked', check that the player comes indeed from the correct IP address
+        bool locked = false;
+        if (account->locked)                                // if ip is locked
         {
-            Field* fields = result->Fetch();
-
-            ///- If the IP is 'locked', check that the player comes indeed from the correct IP address
-            bool locked = false;
-            if (fields[2].GetUInt8() == 1)               // if ip is locked
+            DEBUG_LOG("[AuthChallenge] Account '%s' is locked to IP - '%s'", _login.c_str(), account->lastIp.c_str());
+            DEBUG_LOG("[AuthChallenge] Player address is '%s'", m_address.c_str());
+            if (account->lastIp != m_address)
             {
-                DEBUG_LOG("[AuthChallenge] Account '%s' is locked to IP - '%s'", _login.c_str(), fields[3].GetString());
-                DEBUG_LOG("[AuthChallenge] Player address is '%s'", m_address.c_str());
-                if (strcmp(fields[3].GetString(), m_address.c_str()))
-                {
-                    DEBUG_LOG("[AuthChallenge] Account IP differs");
-                    pkt << (uint8) WOW_FAIL_SUSPENDED;
-                    locked = true;
-                }
-                else
-                {
-                    DEBUG_LOG("[AuthChallenge] Account IP matches");
-                }
+                DEBUG_LOG("[AuthChallenge] Account IP differs");
+                pkt << (uint8) WOW_FAIL_SUSPENDED;
+                locked = true;
             }
             else
             {
-                DEBUG_LOG("[AuthChallenge] Account '%s' is not locked to ip", _login.c_str());
+                DEBUG_LOG("[AuthChallenge] Account IP matches");
             }
+        }
+        else
+        {
+            DEBUG_LOG("[AuthChallenge] Account '%s' is not locked to ip", _login.c_str());
+        }
 
-            if (!locked)
+        if (!locked)
+        {
+            if (account->suspended)
             {
-                if (fields[8].GetUInt8() == 1)
-                {
-                    pkt << (uint8)WOW_FAIL_SUSPENDED;
-                    BASIC_LOG("[AuthChallenge] Suspended account %s tries to login!", _login.c_str());
-                }
-                else
-                {
-                    ///- Get the password from the account table, upper it, and make the SRP6 calculation
-                    std::string rI = fields[0].GetCppString();
+                pkt << (uint8)WOW_FAIL_SUSPENDED;
+                BASIC_LOG("[AuthChallenge] Suspended account %s tries to login!", _login.c_str());
+            }
+            else
+            {
+                ///- Get the password from the account table, upper it, and make the SRP6 calculation
+                std::string const& rI = account->passHash;
 
-                    ///- Don't calculate (v, s) if there are already some in the database
-                    std::string databaseV = fields[5].GetCppString();
-                    std::string databaseS = fields[6].GetCppString();
+                ///- Don't calculate (v, s) if there are already some in the database
+                std::string const& databaseV = account->v;
+                std::string const& databaseS = account->s;
 
-                    DEBUG_LOG("database authentication values: v='%s' s='%s'", databaseV.c_str(), databaseS.c_str());
+                DEBUG_LOG("database authentication values: v='%s' s='%s'", databaseV.c_str(), databaseS.c_str());
 
-                    // multiply with 2, bytes are stored as hexstring
-                    if (databaseV.size() != s_BYTE_SIZE * 2 || databaseS.size() != s_BYTE_SIZE * 2)
-                        _SetVSFields(rI);
-                    else
-                    {
-                        s.SetHexStr(databaseS.c_str());
-                        v.SetHexStr(databaseV.c_str());
-                    }
+                // multiply with 2, bytes are stored as hexstring
+                if (databaseV.size() != s_BYTE_SIZE * 2 || databaseS.size() != s_BYTE_SIZE * 2)
+                    _SetVSFields(rI);
+                else
+                {
+                    s.SetHexStr(databaseS.c_str());
+                    v.SetHexStr(databaseV.c_str());
+                }
 
-                    b.SetRand(19 * 8);
-                    BigNumber gmod = g.ModExp(b, N);
-                    B = ((v * 3) + gmod) % N;
+                b.SetRand(19 * 8);
+                BigNumber gmod = sSRP6Params.ModExpG(b);
+                B = ((v * sSRP6Params.GetK()) + gmod) % sSRP6Params.GetN();
 
-                    assert(gmod.GetNumBytes() <= 32);
+                assert(gmod.GetNumBytes() <= 32);
 
-                    BigNumber unk3;
-                    unk3.SetRand(16 * 8);
+                BigNumber unk3;
+                unk3.SetRand(16 * 8);
 
-                    ///- Fill the response packet with the result
-                    pkt << uint8(WOW_SUCCESS);
+                ///- Fill the response packet with the result
+                pkt << uint8(WOW_SUCCESS);
 
-                    // B may be calculated < 32B so we force minimal length to 32B
-                    pkt.append(B.AsByteArray(32), 32);      // 32 bytes
-                    pkt << uint8(1);
-                    pkt.append(g.AsByteArray(), 1);
-                    pkt << uint8(32);
-                    pkt.append(N.AsByteArray(32), 32);
-                    pkt.append(s.AsByteArray(), s.GetNumBytes());// 32 bytes
-                    pkt.append(unk3.AsByteArray(16), 16);
-                    uint8 securityFlags = 0;
+                uint8 bytes[s_BYTE_SIZE];
 
-                    _token = fields[7].GetCppString();
-                    if (!_token.empty() && _build >= 8606) // authenticator was added in 2.4.3
-                        securityFlags = SECURITY_FLAG_AUTHENTICATOR;
+                // B may be calculated < 32B so we force minimal length to 32B
+                B.WriteBytes(bytes, 32);
+                pkt.append(bytes, 32);                  // 32 bytes
+                pkt << uint8(1);
+                pkt << sSRP6Params.GetGByte();
+                pkt << uint8(32);
+                pkt.append(sSRP6Params.GetNBytes(), SRP6Params::NBytes);
+                s.WriteBytes(bytes, s.GetNumBytes());
+                pkt.append(bytes, s.GetNumBytes());     // 32 bytes
+                unk3.WriteBytes(bytes, 16);
+                pkt.append(bytes, 16);
+                uint8 securityFlags = 0;
 
-                    pkt << uint8(securityFlags);                    // security flags (0x0...0x04)
+                _token = account->token;
+                if (!_token.empty() && _build >= 8606) // authenticator was added in 2.4.3
+                    securityFlags = SECURITY_FLAG_AUTHENTICATOR;
 
-                    if (securityFlags & SECURITY_FLAG_PIN)          // PIN input
-                    {
-                        pkt << uint32(0);
-                        pkt << uint64(0);
-                        pkt << uint64(0);
-                    }
+                pkt << uint8(securityFlags);                    // security flags (0x0...0x04)
 
-                    if (securityFlags & SECURITY_FLAG_UNK)          // Matrix input
-                    {
-                        pkt << uint8(0);
-                        pkt << uint8(0);
-                        pkt << uint8(0);
-                        pkt << uint8(0);
-                        pkt << uint64(0);
-                    }
+                if (securityFlags & SECURITY_FLAG_PIN)          // PIN input
+                {
+                    pkt << uint32(0);
+                    pkt << uint64(0);
+                    pkt << uint64(0);
+                }
 
-                    if (securityFlags & SECURITY_FLAG_AUTHENTICATOR)    // Authenticator input
-                        pkt << uint8(1);
+                if (securityFlags & SECURITY_FLAG_UNK)          // Matrix input
+                {
+                    pkt << uint8(0);
+                    pkt << uint8(0);
+                    pkt << uint8(0);
+                    pkt << uint8(0);
+                    pkt << uint64(0);
+                }
 
-                    uint8 secLevel = fields[4].GetUInt8();
-                    _accountSecurityLevel = secLevel <= SEC_ADMINISTRATOR ? AccountTypes(secLevel) : SEC_ADMINISTRATOR;
+                if (securityFlags & SECURITY_FLAG_AUTHENTICATOR)    // Authenticator input
+                    pkt << uint8(1);
 
-                    _localizationName.resize(4);
-                    for (int i = 0; i < 4; ++i)
-                        _localizationName[i] = ch->country[4 - i - 1];
+                uint8 secLevel = account->securityLevel;
+                _accountSecurityLevel = secLevel <= SEC_ADMINISTRATOR ? AccountTypes(secLevel) : SEC_ADMINISTRATOR;
 
-                    BASIC_LOG("[AuthChallenge] account %s is using '%c%c%c%c' locale (%u)", _login.c_str(), ch->country[3], ch->country[2], ch->country[1], ch->country[0], GetLocaleByName(_localizationName));
+                BASIC_LOG("[AuthChallenge] account %s is using '%s' locale (%u)", _login.c_str(), _localizationName.c_str(), GetLocaleByName(_localizationName));
 
-                    ///- All good, await client's proof
-                    _status = STATUS_LOGON_PROOF;
-                }
+                ///- All good, await client's proof
+                SetStatus(STATUS_LOGON_PROOF);
             }
-            delete result;
         }
-        else                                                // no account
-            pkt << (uint8) WOW_FAIL_UNKNOWN_ACCOUNT;
     }
+    else                                                    // no account
+        pkt << (uint8) WOW_FAIL_UNKNOWN_ACCOUNT;
 
     Write((const char*)pkt.contents(), pkt.size());
     return true;
@@ -540,7 +793,7 @@ bool AuthSocket::_HandleLogonProof()
         return false;
 
     ///- Session is closed unless overriden
-    _status = STATUS_CLOSED;
+    SetStatus(STATUS_CLOSED);
 
     /// <ul><li> If the client has no valid version
     if (!FindBuildInfo(_build))
@@ -564,76 +817,46 @@ bool AuthSocket::_HandleLogonProof()
     if (A.isZero())
         return false;
 
-    if ((A % N).isZero())
+    // A % N == 0
+    Mont256::Element montA;
+    sSRP6Params.GetMont256().FromBytes(montA, lp.A, 32);
+    if (sSRP6Params.GetMont256().IsZero(montA))
         return false;
 
     Sha1Hash sha;
     sha.UpdateBigNumbers(&A, &B, nullptr);
     sha.Finalize();
-    BigNumber u;
-    u.SetBinary(sha.GetDigest(), 20);
-    BigNumber S = (A * (v.ModExp(u, N))).ModExp(b, N);
-
-    uint8 t[32];
-    uint8 t1[16];
-    uint8 vK[40];
-    memcpy(t, S.AsByteArray(32), 32);
-    for (int i = 0; i < 16; ++i)
-    {
-        t1[i] = t[i * 2];
-    }
-    sha.Initialize();
-    sha.UpdateData(t1, 16);
-    sha.Finalize();
-    for (int i = 0; i < 20; ++i)
-    {
-        vK[i * 2] = sha.GetDigest()[i];
-    }
-    for (int i = 0; i < 16; ++i)
-    {
-        t1[i] = t[i * 2 + 1];
-    }
-    sha.Initialize();
-    sha.UpdateData(t1, 16);
-    sha.Finalize();
-    for (int i = 0; i < 20; ++i)
-    {
-        vK[i * 2 + 1] = sha.GetDigest()[i];
-    }
-    K.SetBinary(vK, 40);
 
-    uint8 hash[20];
+    ///- S = (A * v^u) ^ b, u being the digest, and the proofs following from it
+    std::shared_ptr<LogonProofMath> math = std::make_shared<LogonProofMath>();
+    if (!math->Load(lp, v, sha.GetDigest(), b, s, B, _login))
+        return false;
 
-    sha.Initialize();
-    sha.UpdateBigNumbers(&N, nullptr);
-    sha.Finalize();
-    memcpy(hash, sha.GetDigest(), 20);
-    sha.Initialize();
-    sha.UpdateBigNumbers(&g, nullptr);
-    sha.Finalize();
-    for (int i = 0; i < 20; ++i)
+    if (!s_cryptoPool)
     {
-        hash[i] ^= sha.GetDigest()[i];
+        LogonProofMath* single = math.get();
+        LogonProofMath::Compute(&single, 1);
+        return _FinishLogonProof(math->proof, math->K, math->M, math->M2);
     }
-    BigNumber t3;
-    t3.SetBinary(hash, 20);
 
-    sha.Initialize();
-    sha.UpdateData(_login);
-    sha.Finalize();
-    uint8 t4[SHA_DIGEST_LENGTH];
-    memcpy(t4, sha.GetDigest(), SHA_DIGEST_LENGTH);
+    // the proof goes to the crypto pool, this connection handles nothing else until it is done
+    std::shared_ptr<AuthSocket> self = shared<AuthSocket>();
+    SuspendIncoming();
+    s_logonProofQueue.Submit(*s_cryptoPool, math, [self, math] ()
+    {
+        self->ResumeIncoming([self, math] () { return self->_FinishLogonProof(math->proof, math->K, math->M, math->M2); });
+    });
 
-    sha.Initialize();
-    sha.UpdateBigNumbers(&t3, nullptr);
-    sha.UpdateData(t4, SHA_DIGEST_LENGTH);
-    sha.UpdateBigNumbers(&s, &A, &B, &K, nullptr);
-    sha.Finalize();
-    BigNumber M;
-    M.SetBinary(sha.GetDigest(), 20);
+    return true;
+}
+
+/// Second half of the logon proof, once the session key and both proofs are known
+bool AuthSocket::_FinishLogonProof(sAuthLogonProof_C const& lp, uint8 const* sessionKey, uint8 const* M, uint8 const* M2)
+{
+    K.SetBinary(sessionKey, 40);
 
     ///- Check if SRP6 results match (password is correct), else send an error
-    if (!memcmp(M.AsByteArray(), lp.M1, 20))
+    if (!memcmp(M, lp.M1, 20))
     {
         if (lp.securityFlags & SECURITY_FLAG_AUTHENTICATOR || !_token.empty())
         {
@@ -657,23 +880,31 @@ bool AuthSocket::_HandleLogonProof()
             }
         }
 
-        BASIC_LOG("User '%s' successfully authenticated", _login.c_str());
+        ///- The cache does not see the changes made outside of this server, such as a new password, a lock or a
+        ///  ban.  A challenge answered from it is checked against the database before the login is accepted
+        if (_cachedAccount)
+        {
+            std::shared_ptr<AccountRecord const> const cached = std::move(_cachedAccount);
+            std::vector<uint8> const serverProof(M2, M2 + SHA_DIGEST_LENGTH);
 
-        ///- Update the sessionkey, last_ip, last login time and reset number of failed logins in the account table for this account
-        // No SQL injection (escaped user name) and IP address as received by socket
-        const char* K_hex = K.AsHexStr();
-        LoginDatabase.PExecute("UPDATE users_account SET SessionKey = '%s', LastIp = '%s', LastLoginTime = NOW(), Locale = '%u', FailedLoginsAttempt = 0 WHERE UserName = '%s'", K_hex, m_address.c_str(), GetLocaleByName(_localizationName), _safelogin.c_str());
-        OPENSSL_free((void*)K_hex);
+            SuspendForQuery(AccountLookupSql(_login), [this, cached, serverProof] (QueryResultList const& results)
+            {
+                AccountRecord account;
+                if (ReadAccountLookup(results, account) && account == *cached && !sBanCache.IsAccountBanned(account.id))
+                    return _AcceptLogonProof(serverProof.data());
 
-        ///- Finish SRP6 and send the final result to the client
-        sha.Initialize();
-        sha.UpdateBigNumbers(&A, &M, &K, nullptr);
-        sha.Finalize();
+                // the next challenge reads the account from the database
+                sAccountCache.Invalidate(_login);
+                BASIC_LOG("[AuthChallenge] account %s changed since its challenge was answered, login refused", _login.c_str());
 
-        SendProof(sha);
+                const char data[4] = { CMD_AUTH_LOGON_PROOF, WOW_FAIL_UNKNOWN_ACCOUNT, 3, 0};
+                Write(data, _build > 6005 ? 4 : 2);         // 1.x not react incorrectly at 4-byte message
+                return true;
+            });
+            return true;
+        }
 
-        ///- Set _status to authed!
-        _status = STATUS_AUTHED;
+        return _AcceptLogonProof(M2);
     }
     else
     {
@@ -690,18 +921,33 @@ bool AuthSocket::_HandleLogonProof()
         }
         BASIC_LOG("[AuthChallenge] account %s tried to login with wrong password!", _login.c_str());
 
+        // the password may have been changed since the account was cached
+        sAccountCache.Invalidate(_login);
+
         uint32 MaxWrongPassCount = sConfig.GetIntDefault("WrongPass.MaxCount", 0);
         if (MaxWrongPassCount > 0)
         {
-            // Increment number of failed logins by one and if it reaches the limit temporarily ban that account or IP
-            LoginDatabase.PExecute("UPDATE users_account SET FailedLoginsAttempt = FailedLoginsAttempt + 1 WHERE UserName = '%s'", _safelogin.c_str());
-
-            if (QueryResult* loginfail = LoginDatabase.PQuery("SELECT Id, FailedLoginsAttempt FROM account WHERE UserName = '%s'", _safelogin.c_str()))
+            // Increment number of failed logins by one and if it reaches the limit temporarily ban that account or IP.
+            // The increment and the read run on one connection, LAST_INSERT_ID() hands each failure its own count
+            // so that concurrent failures never see the same one.
+            static SqlStatementID incrementFailedLogins;
+            static SqlStatementID selectFailedLogins;
+            SqlStatement updateStmt = LoginDatabase.CreateStatement(incrementFailedLogins, "UPDATE users_account SET FailedLoginsAttempt = LAST_INSERT_ID(FailedLoginsAttempt + 1) WHERE UserName = ?");
+            SqlStatement selectStmt = LoginDatabase.CreateStatement(selectFailedLogins, "SELECT Id, LAST_INSERT_ID() FROM users_account WHERE UserName = ?");
+            updateStmt.addString(_login);
+            selectStmt.addString(_login);
+            std::string const login = _login;
+            std::string const address = m_address;
+            selectStmt.AsyncQueryAfter(updateStmt, [MaxWrongPassCount, login, address] (QueryResult* loginfail, bool /*failed*/)
             {
+                if (!loginfail)
+                    return;
+
                 Field* fields = loginfail->Fetch();
                 uint32 failed_logins = fields[1].GetUInt32();
 
-                if (failed_logins >= MaxWrongPassCount)
+                // one failure in every MaxWrongPassCount bans, an expired ban is earned again rather than renewed by each failure
+                if (failed_logins % MaxWrongPassCount == 0)
                 {
                     uint32 WrongPassBanTime = sConfig.GetIntDefault("WrongPass.BanTime", 600);
                     bool WrongPassBanType = sConfig.GetBoolDefault("WrongPass.BanType", false);
@@ -709,28 +955,53 @@ bool AuthSocket::_HandleLogonProof()
                     if (WrongPassBanType)
                     {
                         uint32 acc_id = fields[0].GetUInt32();
-                        LoginDatabase.PExecute("INSERT INTO account_banned VALUES ('%u',UNIX_TIMESTAMP(),UNIX_TIMESTAMP()+'%u','CMaNGOS Auth','Failed login autoban')",
-                                               acc_id, WrongPassBanTime);
+                        static SqlStatementID insertAccountBan;
+                        SqlStatement banStmt = LoginDatabase.CreateStatement(insertAccountBan, "INSERT INTO banned_account VALUES (?,UNIX_TIMESTAMP(),UNIX_TIMESTAMP()+?,'CMaNGOS Auth','Failed login autoban')");
+                        banStmt.PExecute(acc_id, WrongPassBanTime);
+                        sBanCache.AddAccountBan(acc_id, time(nullptr) + WrongPassBanTime);
                         BASIC_LOG("[AuthChallenge] account %s got banned for '%u' seconds because it failed to authenticate '%u' times",
-                                  _login.c_str(), WrongPassBanTime, failed_logins);
+                                  login.c_str(), WrongPassBanTime, failed_logins);
                     }
                     else
                     {
-                        std::string current_ip = m_address;
-                        LoginDatabase.escape_string(current_ip);
-                        LoginDatabase.PExecute("INSERT INTO banned_ip VALUES ('%s',UNIX_TIMESTAMP(),UNIX_TIMESTAMP()+'%u','CMaNGOS Auth','Failed login autoban')",
-                                               current_ip.c_str(), WrongPassBanTime);
+                        static SqlStatementID insertIpBan;
+                        SqlStatement banStmt = LoginDatabase.CreateStatement(insertIpBan, "INSERT INTO banned_ip VALUES (?,UNIX_TIMESTAMP(),UNIX_TIMESTAMP()+?,'CMaNGOS Auth','Failed login autoban')");
+                        banStmt.PExecute(address.c_str(), WrongPassBanTime);
+                        sBanCache.AddIpBan(address, time(nullptr) + WrongPassBanTime);
                         BASIC_LOG("[AuthChallenge] IP %s got banned for '%u' seconds because account %s failed to authenticate '%u' times",
-                                  current_ip.c_str(), WrongPassBanTime, _login.c_str(), failed_logins);
+                                  address.c_str(), WrongPassBanTime, login.c_str(), failed_logins);
                     }
                 }
                 delete loginfail;
-            }
+            });
         }
     }
     return true;
 }
 
+/// Accepts a logon proof that matched: stores the session and sends the server proof
+bool AuthSocket::_AcceptLogonProof(uint8 const* M2)
+{
+    BASIC_LOG("User '%s' successfully authenticated", _login.c_str());
+
+    ///- Update the sessionkey, last_ip, last login time and reset number of failed logins in the account table for this account
+    char K_hex[40 * 2 + 1];
+    K.WriteHexStr(K_hex, sizeof(K_hex));
+
+    static SqlStatementID updateSession;
+    SqlStatement stmt = LoginDatabase.CreateStatement(updateSession, "UPDATE users_account SET SessionKey = ?, LastIp = ?, LastLoginTime = NOW(), Locale = ?, FailedLoginsAttempt = 0 WHERE UserName = ?");
+    stmt.PExecute(K_hex, m_address.c_str(), uint32(GetLocaleByName(_localizationName)), _login.c_str());
+
+    sAccountCache.Modify(_login, [this] (AccountRecord& account) { account.lastIp = m_address; });
+
+    ///- Finish SRP6 and send the final result to the client
+    SendProof(M2);
+
+    ///- Set _status to authed!
+    SetStatus(STATUS_AUTHED);
+    return true;
+}
+
 /// Reconnect Challenge command handler
 bool AuthSocket::_HandleReconnectChallenge()
 {
@@ -754,7 +1025,7 @@ bool AuthSocket::_HandleReconnectChallenge()
         return false;
 
     ///- Session is closed unless overriden
-    _status = STATUS_CLOSED;
+    SetStatus(STATUS_CLOSED);
 
     // No big fear of memory outage (size is int16, i.e. < 65536)
     buf.resize(remaining + buf.size() + 1);
@@ -768,14 +1039,20 @@ bool AuthSocket::_HandleReconnectChallenge()
 
     _login = (const char*)ch->I;
 
-    _safelogin = _login;
-    LoginDatabase.escape_string(_safelogin);
-
     EndianConvert(ch->build);
     _build = ch->build;
 
-    QueryResult* result = LoginDatabase.PQuery("SELECT SessionKey FROM users_account WHERE UserName = '%s'", _safelogin.c_str());
+    static SqlStatementID selectSessionKey;
+    SqlStatement stmt = LoginDatabase.CreateStatement(selectSessionKey, "SELECT SessionKey FROM users_account WHERE UserName = ?");
+    stmt.addString(_login);
 
+    SuspendForQuery(stmt, [this] (QueryResult* result) { return _FinishReconnectChallenge(result); });
+    return true;
+}
+
+/// Second half of the reconnect challenge, once the session key is known
+bool AuthSocket::_FinishReconnectChallenge(QueryResult* result)
+{
     // Stop if the account is not found
     if (!result)
     {
@@ -786,17 +1063,18 @@ bool AuthSocket::_HandleReconnectChallenge()
 
     Field* fields = result->Fetch();
     K.SetHexStr(fields[0].GetString());
-    delete result;
 
     ///- All good, await client's proof
-    _status = STATUS_RECON_PROOF;
+    SetStatus(STATUS_RECON_PROOF);
 
     ///- Sending response
     ByteBuffer pkt;
     pkt << (uint8)  CMD_AUTH_RECONNECT_CHALLENGE;
     pkt << (uint8)  0x00;
     _reconnectProof.SetRand(16 * 8);
-    pkt.append(_reconnectProof.AsByteArray(16), 16);        // 16 bytes random
+    uint8 bytes[16];
+    _reconnectProof.WriteBytes(bytes, 16);
+    pkt.append(bytes, 16);                                  // 16 bytes random
     pkt << (uint64) 0x00 << (uint64) 0x00;                  // 16 bytes zeros
     Write((const char*)pkt.contents(), pkt.size());
     return true;
@@ -812,7 +1090,7 @@ bool AuthSocket::_HandleReconnectProof()
         return false;
 
     ///- Session is closed unless overriden
-    _status = STATUS_CLOSED;
+    SetStatus(STATUS_CLOSED);
 
     if (_login.empty() || !_reconnectProof.GetNumBytes() || !K.GetNumBytes())
         return false;
@@ -836,7 +1114,7 @@ bool AuthSocket::_HandleReconnectProof()
         Write((const char*)pkt.contents(), pkt.size());
 
         ///- Set _status to authed!
-        _status = STATUS_AUTHED;
+        SetStatus(STATUS_AUTHED);
 
         return true;
     }
@@ -857,163 +1135,63 @@ bool AuthSocket::_HandleRealmList()
 
     ReadSkip(5);
 
-    ///- Get the user id (else close the connection)
-    // No SQL injection (escaped user name)
-
-    QueryResult* result = LoginDatabase.PQuery("SELECT Id FROM users_account WHERE UserName = '%s'", _safelogin.c_str());
-    if (!result)
-    {
-        sLog.outError("[ERROR] user %s tried to login and we cannot find him in the database.", _login.c_str());
-        Close();
-        return false;
-    }
-
-    uint32 id = (*result)[0].GetUInt32();
-    delete result;
-
-    ///- Update realm list if need
-    sRealmList.UpdateIfNeed();
+    ///- The client is still active, push the idle deadline back
+    UpdateDeadline();
 
-    ///- Circle through realms in the RealmList and construct the return packet (including # of user characters in each realm)
-    ByteBuffer pkt;
-    LoadRealmlist(pkt, id);
+    ///- Repeated requests of the realm screen find the characters in the cache
+    CharacterCounts characters;
+    if (sCharacterCountCache.Find(_login, characters))
+        return _FinishRealmList(characters);
 
-    ByteBuffer hdr;
-    hdr << (uint8) CMD_REALM_LIST;
-    hdr << (uint16)pkt.size();
-    hdr.append(pkt);
+    ///- Get the user id (else close the connection) with the number of characters on every realm, in one query
+    static SqlStatementID selectCharacters;
+    SqlStatement stmt = LoginDatabase.CreateStatement(selectCharacters,
+        "SELECT a.Id, rc.RealmId, rc.NumChars FROM users_account a LEFT JOIN realm_characters rc ON rc.AcctId = a.Id WHERE a.UserName = ?");
+    stmt.addString(_login);
 
-    Write((const char*)hdr.contents(), hdr.size());
-    return true;
-}
-
-void AuthSocket::LoadRealmlist(ByteBuffer& pkt, uint32 acctid)
-{
-    switch (_build)
+    SuspendForQuery(stmt, [this] (QueryResult* result)
     {
-        case 5875:                                          // 1.12.1
-        case 6005:                                          // 1.12.2
-        case 6141:                                          // 1.12.3
+        if (!result)
         {
-            pkt << uint32(0);                               // unused value
-            pkt << uint8(sRealmList.size());
-
-            for (RealmList::RealmMap::const_iterator  i = sRealmList.begin(); i != sRealmList.end(); ++i)
-            {
-                uint8 AmountOfCharacters;
-
-                // No SQL injection. id of realm is controlled by the database.
-                QueryResult* result = LoginDatabase.PQuery("SELECT NumChars FROM realm_characters WHERE RealmId = '%d' AND AcctId='%u'", i->second.m_ID, acctid);
-                if (result)
-                {
-                    Field* fields = result->Fetch();
-                    AmountOfCharacters = fields[0].GetUInt8();
-                    delete result;
-                }
-                else
-                    AmountOfCharacters = 0;
-
-                bool ok_build = std::find(i->second.realmbuilds.begin(), i->second.realmbuilds.end(), _build) != i->second.realmbuilds.end();
-
-                RealmBuildInfo const* buildInfo = ok_build ? FindBuildInfo(_build) : nullptr;
-                if (!buildInfo)
-                    buildInfo = &i->second.realmBuildInfo;
-
-                RealmFlags realmflags = i->second.realmflags;
-
-                // 1.x clients not support explicitly REALM_FLAG_SPECIFYBUILD, so manually form similar name as show in more recent clients
-                std::string name = i->first;
-                if (realmflags & REALM_FLAG_SPECIFYBUILD)
-                {
-                    char buf[20];
-                    snprintf(buf, 20, " (%u,%u,%u)", buildInfo->major_version, buildInfo->minor_version, buildInfo->bugfix_version);
-                    name += buf;
-                }
-
-                // Show offline state for unsupported client builds and locked realms (1.x clients not support locked state show)
-                if (!ok_build || (i->second.allowedSecurityLevel > _accountSecurityLevel))
-                    realmflags = RealmFlags(realmflags | REALM_FLAG_OFFLINE);
-
-                pkt << uint32(i->second.icon);              // realm type
-                pkt << uint8(realmflags);                   // realmflags
-                pkt << name;                                // name
-                pkt << i->second.address;                   // address
-                pkt << float(i->second.populationLevel);
-                pkt << uint8(AmountOfCharacters);
-                pkt << uint8(i->second.timezone);           // realm category
-                pkt << uint8(0x00);                         // unk, may be realm number/id?
-            }
-
-            pkt << uint16(0x0002);                          // unused value (why 2?)
-            break;
+            sLog.outError("[ERROR] user %s tried to login and we cannot find him in the database.", _login.c_str());
+            Close();
+            return false;
         }
 
-        case 8606:                                          // 2.4.3
-        case 10505:                                         // 3.2.2a
-        case 11159:                                         // 3.3.0a
-        case 11403:                                         // 3.3.2
-        case 11723:                                         // 3.3.3a
-        case 12340:                                         // 3.3.5a
-        default:                                            // and later
+        CharacterCounts characters;
+        do
         {
-            pkt << uint32(0);                               // unused value
-            pkt << uint16(sRealmList.size());
-
-            for (RealmList::RealmMap::const_iterator  i = sRealmList.begin(); i != sRealmList.end(); ++i)
-            {
-                uint8 AmountOfCharacters;
-
-                // No SQL injection. id of realm is controlled by the database.
-                QueryResult* result = LoginDatabase.PQuery("SELECT NumChars FROM realm_characters WHERE RealmId = '%d' AND AcctId='%u'", i->second.m_ID, acctid);
-                if (result)
-                {
-                    Field* fields = result->Fetch();
-                    AmountOfCharacters = fields[0].GetUInt8();
-                    delete result;
-                }
-                else
-                    AmountOfCharacters = 0;
-
-                bool ok_build = std::find(i->second.realmbuilds.begin(), i->second.realmbuilds.end(), _build) != i->second.realmbuilds.end();
-
-                RealmBuildInfo const* buildInfo = ok_build ? FindBuildInfo(_build) : nullptr;
-                if (!buildInfo)
-                    buildInfo = &i->second.realmBuildInfo;
-
-                uint8 lock = (i->second.allowedSecurityLevel > _accountSecurityLevel) ? 1 : 0;
-
-                RealmFlags realmFlags = i->second.realmflags;
-
-                // Show offline state for unsupported client builds
-                if (!ok_build)
-                    realmFlags = RealmFlags(realmFlags | REALM_FLAG_OFFLINE);
-
-                //if (!buildInfo) // always false since updated 10 lines above if null. ToDo: fix
-                //    realmFlags = RealmFlags(realmFlags & ~REALM_FLAG_SPECIFYBUILD);
+            Field* fields = result->Fetch();
+            if (!fields[1].IsNULL())
+                characters.Set(fields[1].GetUInt32(), fields[2].GetUInt8());
+        }
+        while (result->NextRow());
 
-                pkt << uint8(i->second.icon);               // realm type (this is second column in Cfg_Configs.dbc)
-                pkt << uint8(lock);                         // flags, if 0x01, then realm locked
-                pkt << uint8(realmFlags);                   // see enum RealmFlags
-                pkt << i->first;                            // name
-                pkt << i->second.address;                   // address
-                pkt << float(i->second.populationLevel);
-                pkt << uint8(AmountOfCharacters);
-                pkt << uint8(i->second.timezone);           // realm category (Cfg_Categories.dbc)
-                pkt << uint8(0x2C);                         // unk, may be realm number/id?
+        sCharacterCountCache.Insert(_login, characters);
+        return _FinishRealmList(characters);
+    });
+    return true;
+}
 
-                if (realmFlags & REALM_FLAG_SPECIFYBUILD)
-                {
-                    pkt << uint8(buildInfo->major_version);
-                    pkt << uint8(buildInfo->minor_version);
-                    pkt << uint8(buildInfo->bugfix_version);
-                    pkt << uint16(_build);
-                }
-            }
+/// Second half of the realm list request, once the characters of the account are known
+bool AuthSocket::_FinishRealmList(CharacterCounts const& characters)
+{
+    ///- The realm list is reloaded by the main thread, this answer uses the version current now
+    RealmList::SnapshotPtr realms = sRealmList.GetSnapshot();
 
-            pkt << uint16(0x0010);                          // unused value (why 10?)
-            break;
-        }
+    ///- The answer rendered for the client build, with the characters and locks of the account written in
+    if (RealmListPacket const* packet = realms->GetPacket(_build))
+    {
+        std::vector<uint8> bytes;
+        packet->Write(bytes, characters, _accountSecurityLevel);
+        Write((const char*)bytes.data(), bytes.size());
+        return true;
     }
+
+    ByteBuffer pkt;
+    RealmListPacket::Render(pkt, realms->realms, _build, characters, _accountSecurityLevel);
+    Write((const char*)pkt.contents(), pkt.size());
+    return true;
 }
 
 /// Resume patch transfer
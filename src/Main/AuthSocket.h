@@ -33,25 +33,56 @@
 #include <boost/asio.hpp>
 
 #include <functional>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <vector>
 
 #define HMAC_RES_SIZE 20
 
+struct AUTH_LOGON_PROOF_C;
+class QueryResult;
+class SqlStatement;
+struct AccountRecord;
+class CharacterCounts;
+
+namespace MaNGOS
+{
+    class WorkerPool;
+}
+
 class AuthSocket : public MaNGOS::Socket
 {
     public:
         const static int s_BYTE_SIZE = 32;
 
-        AuthSocket(boost::asio::io_service& service, std::function<void (Socket*)> closeHandler);
+        // a logon challenge with the longest possible account name is the largest client message
+        const static size_t MaxPacketSize = 512;
+        const static size_t MaxBufferedInput = 2 * MaxPacketSize;
+
+        AuthSocket(boost::asio::io_service& service, std::function<void (Socket*)> closeHandler, MaNGOS::PacketBufferPool& bufferPool, MaNGOS::TimingWheel& timingWheel);
 
-        void SendProof(Sha1Hash sha);
-        void LoadRealmlist(ByteBuffer& pkt, uint32 acctid);
+        /// Read the per state deadlines from the configuration
+        static void LoadTimeouts();
+
+        /// Pool running the SRP6 exponentiations and hashes of the logon proof, nullptr runs them on the network thread
+        static void SetCryptoPool(MaNGOS::WorkerPool* pool) { s_cryptoPool = pool; }
+
+        virtual bool Open() override;
+
+        void SendProof(uint8 const* M2);
         int32 generateToken(char const* b32key);
 
         bool _HandleLogonChallenge();
+        bool _FinishLogonChallenge(AccountRecord const* account);
         bool _HandleLogonProof();
+        bool _FinishLogonProof(AUTH_LOGON_PROOF_C const& lp, uint8 const* sessionKey, uint8 const* M, uint8 const* M2);
+        bool _AcceptLogonProof(uint8 const* M2);
         bool _HandleReconnectChallenge();
+        bool _FinishReconnectChallenge(QueryResult* result);
         bool _HandleReconnectProof();
         bool _HandleRealmList();
+        bool _FinishRealmList(CharacterCounts const& characters);
         // data transfer handle for patch
 
         bool _HandleXferResume();
@@ -71,17 +102,38 @@ class AuthSocket : public MaNGOS::Socket
             STATUS_CLOSED
         };
 
-        BigNumber N, s, g, v;
+        BigNumber s, v;
         BigNumber b, B;
         BigNumber K;
         BigNumber _reconnectProof;
 
         eStatus _status;
 
+        // deadlines in milliseconds, 0 means none
+        static uint32 s_challengeTimeout;
+        static uint32 s_proofTimeout;
+        static uint32 s_realmListTimeout;
+        static uint32 s_sessionTimeout;
+
+        static MaNGOS::WorkerPool* s_cryptoPool;
+
+        std::chrono::steady_clock::time_point _sessionEnd;
+
+        void SetStatus(eStatus status);
+        void UpdateDeadline();
+
+        /// Runs the query on a database thread, the connection handles nothing else until continuation ran on its own thread.
+        /// continuation gets the rows or nullptr for none, a failed query closes the connection instead
+        void SuspendForQuery(SqlStatement& stmt, std::function<bool (QueryResult*)> continuation);
+        /// Same for a multi-statement query, continuation gets one result per statement
+        void SuspendForQuery(std::string const& sql, std::function<bool (std::vector<QueryResult*> const&)> continuation);
+
         std::string _login;
-        std::string _safelogin;
         std::string _token;
 
+        // the record the challenge was answered from when it came from the cache, read again before the proof is accepted
+        std::shared_ptr<AccountRecord const> _cachedAccount;
+
         // Since GetLocaleByName() is _NOT_ bijective, we have to store the locale as a string. Otherwise we can't differ
         // between enUS and enGB, which is important for the patch system
         std::string _localizationName;
@@ -89,6 +141,12 @@ class AuthSocket : public MaNGOS::Socket
         AccountTypes _accountSecurityLevel;
 
         virtual bool ProcessIncomingData() override;
+
+        // the protocol is strictly request/response, answer as soon as a request is handled
+        virtual FlushPolicy GetFlushPolicy() const override { return FlushPolicy::EndOfProcessing; }
+
+        // client messages are small and come one at a time, anything beyond that is garbage
+        virtual InputLimits GetInputLimits() const override { return InputLimits(MaxPacketSize, MaxBufferedInput, OverLimitAction::Close); }
 };
 #endif
 /// @}
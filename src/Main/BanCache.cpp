@@ -0,0 +1,176 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/** \file
+    \ingroup realmd
+*/
+
+#include "BanCache.h"
+#include "Database/DatabaseEnv.h"
+#include "Log/Log.h"
+
+#include <memory>
+
+extern DatabaseType LoginDatabase;
+
+BanCache::BanCache() : m_snapshot(std::make_shared<Snapshot>()), m_refreshInterval(0), m_reloadInterval(0),
+    m_nextRefresh(0), m_nextReload(0), m_lastPoll(0)
+{
+}
+
+BanCache& BanCache::Instance()
+{
+    static BanCache cache;
+    return cache;
+}
+
+void BanCache::Initialize(uint32 refreshInterval, uint32 reloadInterval)
+{
+    m_refreshInterval = refreshInterval;
+    m_reloadInterval = reloadInterval;
+
+    Poll(true);
+
+    sLog.outString("Loaded %u banned ip(s) and %u banned account(s)", uint32(IpCount()), uint32(AccountCount()));
+}
+
+void BanCache::UpdateIfNeed()
+{
+    time_t const now = time(nullptr);
+
+    if (m_reloadInterval && now >= m_nextReload)
+        Poll(true);
+    else if (m_refreshInterval && now >= m_nextRefresh)
+        Poll(false);
+}
+
+bool BanCache::IsIpBanned(std::string const& ip) const
+{
+    SnapshotPtr const snapshot = GetSnapshot();
+
+    auto const found = snapshot->ips.find(ip);
+    return found != snapshot->ips.end() && found->second > time(nullptr);
+}
+
+bool BanCache::IsAccountBanned(uint32 accountId) const
+{
+    SnapshotPtr const snapshot = GetSnapshot();
+
+    auto const found = snapshot->accounts.find(accountId);
+    return found != snapshot->accounts.end() && found->second > time(nullptr);
+}
+
+void BanCache::AddIpBan(std::string const& ip, time_t unbanDate)
+{
+    std::lock_guard<std::mutex> guard(m_writeLock);
+
+    std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>(*GetSnapshot());
+    time_t& current = snapshot->ips[ip];
+    current = std::max(current, unbanDate);
+
+    Publish(snapshot);
+}
+
+void BanCache::AddAccountBan(uint32 accountId, time_t unbanDate)
+{
+    std::lock_guard<std::mutex> guard(m_writeLock);
+
+    std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>(*GetSnapshot());
+    time_t& current = snapshot->accounts[accountId];
+    current = std::max(current, unbanDate);
+
+    Publish(snapshot);
+}
+
+void BanCache::Poll(bool full)
+{
+    time_t const now = time(nullptr);
+    m_nextRefresh = now + m_refreshInterval;
+    if (full)
+        m_nextReload = now + m_reloadInterval;
+
+    // the bans are dated by the database clock, which decides what the next poll has to read
+    QueryResult* clock = LoginDatabase.Query("SELECT UNIX_TIMESTAMP()");
+    if (!clock)
+    {
+        sLog.outError("BanCache: cannot read the database time, bans are not refreshed");
+        return;
+    }
+    time_t const pollStart = time_t(clock->Fetch()[0].GetUInt64());
+    delete clock;
+
+    // writers wait for the poll, so that no autoban is lost by publishing a copy made before it.  an autoban whose
+    // insert is still queued may be missed by a full reload, the next poll brings it back
+    std::lock_guard<std::mutex> guard(m_writeLock);
+
+    std::shared_ptr<Snapshot> snapshot = full ? std::make_shared<Snapshot>() : std::make_shared<Snapshot>(*GetSnapshot());
+    Load(*snapshot, full ? 0 : m_lastPoll);
+    Prune(*snapshot, now);
+
+    m_lastPoll = pollStart;
+    Publish(snapshot);
+}
+
+void BanCache::Load(Snapshot& snapshot, time_t since)
+{
+    // bans given in the same second as the last poll are read twice rather than missed
+    if (QueryResult* result = LoginDatabase.PQuery("SELECT ip, UnBanDate FROM banned_ip WHERE UnBanDate > UNIX_TIMESTAMP() AND BanDate >= " UI64FMTD, uint64(since)))
+    {
+        do
+        {
+            Field* fields = result->Fetch();
+            time_t& unbanDate = snapshot.ips[fields[0].GetCppString()];
+            unbanDate = std::max(unbanDate, time_t(fields[1].GetUInt64()));
+        }
+        while (result->NextRow());
+
+        delete result;
+    }
+
+    if (QueryResult* result = LoginDatabase.PQuery("SELECT id, UnBanDate FROM banned_account WHERE UnBanDate > UNIX_TIMESTAMP() AND BanDate >= " UI64FMTD, uint64(since)))
+    {
+        do
+        {
+            Field* fields = result->Fetch();
+            time_t& unbanDate = snapshot.accounts[fields[0].GetUInt32()];
+            unbanDate = std::max(unbanDate, time_t(fields[1].GetUInt64()));
+        }
+        while (result->NextRow());
+
+        delete result;
+    }
+}
+
+void BanCache::Prune(Snapshot& snapshot, time_t now)
+{
+    for (auto itr = snapshot.ips.begin(); itr != snapshot.ips.end();)
+    {
+        if (itr->second <= now)
+            itr = snapshot.ips.erase(itr);
+        else
+            ++itr;
+    }
+
+    for (auto itr = snapshot.accounts.begin(); itr != snapshot.accounts.end();)
+    {
+        if (itr->second <= now)
+            itr = snapshot.accounts.erase(itr);
+        else
+            ++itr;
+    }
+}
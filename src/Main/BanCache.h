@@ -0,0 +1,97 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/// \addtogroup realmd
+/// @{
+/// \file
+
+#ifndef _BANCACHE_H
+#define _BANCACHE_H
+
+#include "Common.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/// Active bans of banned_ip and banned_account, checked without the database.
+/// Readers look into an immutable snapshot they hold a reference to; every change publishes a
+/// modified copy.  A replaced snapshot is freed by the last lookup still using it.
+class BanCache
+{
+    public:
+        static BanCache& Instance();
+
+        BanCache();
+
+        /// Load every active ban.  New bans are polled every refreshInterval seconds, the whole
+        /// tables are read again every reloadInterval seconds to catch lifted or shortened bans
+        void Initialize(uint32 refreshInterval, uint32 reloadInterval);
+
+        /// Called regularly by the main thread, polls the database when an interval has passed
+        void UpdateIfNeed();
+
+        bool IsIpBanned(std::string const& ip) const;
+        bool IsAccountBanned(uint32 accountId) const;
+
+        /// Bans issued by the server itself, visible to the next lookup
+        void AddIpBan(std::string const& ip, time_t unbanDate);
+        void AddAccountBan(uint32 accountId, time_t unbanDate);
+
+        size_t IpCount() const { return GetSnapshot()->ips.size(); }
+        size_t AccountCount() const { return GetSnapshot()->accounts.size(); }
+
+    private:
+        /// unban dates by banned address or account id
+        struct Snapshot
+        {
+            std::unordered_map<std::string, time_t> ips;
+            std::unordered_map<uint32, time_t> accounts;
+        };
+
+        typedef std::shared_ptr<Snapshot const> SnapshotPtr;
+
+        BanCache(BanCache const&) = delete;
+        BanCache& operator=(BanCache const&) = delete;
+
+        /// Reads the new bans, or all of them, and publishes the result
+        void Poll(bool full);
+        /// Adds the active bans given since 'since' (all of them for 0) to snapshot
+        static void Load(Snapshot& snapshot, time_t since);
+        static void Prune(Snapshot& snapshot, time_t now);
+
+        SnapshotPtr GetSnapshot() const { return std::atomic_load(&m_snapshot); }
+        /// Replaces the current snapshot, m_writeLock held
+        void Publish(std::shared_ptr<Snapshot> const& snapshot) { std::atomic_store(&m_snapshot, SnapshotPtr(snapshot)); }
+
+        SnapshotPtr m_snapshot;                             ///< only accessed through std::atomic_load and std::atomic_store
+
+        std::mutex m_writeLock;                             ///< serializes the writers, never taken by lookups
+
+        uint32 m_refreshInterval;
+        uint32 m_reloadInterval;
+        time_t m_nextRefresh;
+        time_t m_nextReload;
+        time_t m_lastPoll;                                  ///< bans given at or after this were not seen yet
+};
+
+#define sBanCache BanCache::Instance()
+
+#endif
+/// @}
@@ -0,0 +1,112 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/** \file
+    \ingroup realmd
+*/
+
+#include "CharacterCountCache.h"
+#include "AccountCache.h"
+
+CharacterCountCache::CharacterCountCache() : m_ttl(Clock::duration::zero()), m_maxEntries(0), m_hits(0), m_misses(0)
+{
+}
+
+CharacterCountCache& CharacterCountCache::Instance()
+{
+    static CharacterCountCache cache;
+    return cache;
+}
+
+void CharacterCountCache::Initialize(uint32 ttl, size_t maxEntries)
+{
+    if (!ttl || !maxEntries)
+        return;
+
+    m_ttl = std::chrono::seconds(ttl);
+    m_maxEntries = maxEntries;
+}
+
+bool CharacterCountCache::Find(std::string const& login, CharacterCounts& counts)
+{
+    if (!IsEnabled())
+        return false;
+
+    std::string const key = UserNameKey(login);
+
+    std::lock_guard<std::mutex> guard(m_lock);
+
+    auto const found = m_entries.find(key);
+    if (found == m_entries.end() || found->second.expires <= Clock::now())
+    {
+        ++m_misses;
+        return false;
+    }
+
+    counts = found->second.counts;
+    ++m_hits;
+    return true;
+}
+
+void CharacterCountCache::Insert(std::string const& login, CharacterCounts const& counts)
+{
+    if (!IsEnabled())
+        return;
+
+    std::string const key = UserNameKey(login);
+
+    Clock::time_point const now = Clock::now();
+
+    std::lock_guard<std::mutex> guard(m_lock);
+
+    if (m_entries.size() >= m_maxEntries && m_entries.find(key) == m_entries.end())
+        MakeRoom(now);
+
+    Entry& entry = m_entries[key];
+    entry.counts = counts;
+    entry.expires = now + m_ttl;
+}
+
+void CharacterCountCache::MakeRoom(Clock::time_point now)
+{
+    for (auto itr = m_entries.begin(); itr != m_entries.end();)
+    {
+        if (itr->second.expires <= now)
+            itr = m_entries.erase(itr);
+        else
+            ++itr;
+    }
+
+    // every entry is recent, a quarter of them is dropped so that the next inserts do not sweep again.
+    // the ones dropped are simply read again
+    if (m_entries.size() >= m_maxEntries)
+        while (m_entries.size() > m_maxEntries - m_maxEntries / 4 - 1)
+            m_entries.erase(m_entries.begin());
+}
+
+CharacterCountCache::Stats CharacterCountCache::GetStats()
+{
+    Stats stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    stats.entries = m_entries.size();
+
+    return stats;
+}
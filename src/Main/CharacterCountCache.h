@@ -0,0 +1,91 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/// \addtogroup realmd
+/// @{
+/// \file
+
+#ifndef _CHARACTERCOUNTCACHE_H
+#define _CHARACTERCOUNTCACHE_H
+
+#include "Common.h"
+#include "RealmList.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/// Character counts read by the last realm list request of an account.  The client asks for the
+/// list every few seconds while it shows it, these requests are answered without the database.
+/// The counts are written by the world servers and are only seen by this server once they expire.
+class CharacterCountCache
+{
+    public:
+        struct Stats
+        {
+            uint64 hits;
+            uint64 misses;
+            uint64 entries;
+        };
+
+        static CharacterCountCache& Instance();
+
+        CharacterCountCache();
+
+        /// ttl in seconds, 0 for either disables the cache
+        void Initialize(uint32 ttl, size_t maxEntries);
+
+        bool IsEnabled() const { return m_maxEntries != 0; }
+
+        /// Copies the counts of login into counts, false when they are not cached or have expired
+        bool Find(std::string const& login, CharacterCounts& counts);
+
+        void Insert(std::string const& login, CharacterCounts const& counts);
+
+        Stats GetStats();
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct Entry
+        {
+            CharacterCounts counts;
+            Clock::time_point expires;
+        };
+
+        CharacterCountCache(CharacterCountCache const&) = delete;
+        CharacterCountCache& operator=(CharacterCountCache const&) = delete;
+
+        /// Drops the expired entries, and arbitrary ones if the cache is still full, m_lock held
+        void MakeRoom(Clock::time_point now);
+
+        std::mutex m_lock;
+        std::unordered_map<std::string, Entry> m_entries;   ///< by upper case user name
+        Clock::duration m_ttl;
+        size_t m_maxEntries;
+
+        std::atomic<uint64> m_hits;
+        std::atomic<uint64> m_misses;
+};
+
+#define sCharacterCountCache CharacterCountCache::Instance()
+
+#endif
+/// @}
@@ -22,7 +22,13 @@
 #include "Config/Config.h"
 #include "Log/Log.h"
 #include "RealmList.h"
+#include "BanCache.h"
+#include "AccountCache.h"
+#include "AccountNameFilter.h"
+#include "CharacterCountCache.h"
 #include "AuthSocket.h"
+#include "Auth/SRP6Params.h"
+#include "Threading/WorkerPool.h"
 
 #include <iostream>
 #include <chrono>
@@ -65,7 +71,8 @@ bool StartDB()
         return false;
     }
 
-    if (!LoginDatabase.Initialize(dbstring.c_str()))
+    // every query connection gets a query thread, the network threads hand the login queries to them
+    if (!LoginDatabase.Initialize(dbstring.c_str(), sConfig.GetIntDefault("LoginDatabaseConnections", 1)))
     {
         sLog.outError("Cannot connect to database");
         return false;
@@ -78,6 +85,8 @@ bool StartDB()
         return false;
     }
 
+    LoginDatabase.InitQueryThreads();
+
     sLog.outString("MySQL client library: %s", LoginDatabase.GetClientInfo().c_str());
     sLog.outString("MySQL server ver: %s ", LoginDatabase.GetServerInfo().c_str());
 
@@ -165,8 +174,51 @@ int main(int argc, char* argv[])
     LoginDatabase.Execute("DELETE FROM banned_ip WHERE UnBanDate<=UNIX_TIMESTAMP()");
     LoginDatabase.CommitTransaction();
 
-    // FIXME - more intelligent selection of thread count is needed here.  config option?
-    MaNGOS::Listener<AuthSocket> listener(sConfig.GetStringDefault("BindIP", "0.0.0.0"), sConfig.GetIntDefault("RealmServerPort", DEFAULT_REALMSERVER_PORT), 1);
+    ///- Active bans are checked in memory, new ones are polled from then on
+    sBanCache.Initialize(sConfig.GetIntDefault("BanRefreshInterval", 10), sConfig.GetIntDefault("BanReloadInterval", 600));
+
+    ///- Account details of recent logins, for the retries
+    sAccountCache.Initialize(sConfig.GetIntDefault("AccountCache.TTL", 60), size_t(sConfig.GetIntDefault("AccountCache.MemoryKB", 4096)) * 1024);
+
+    ///- Every user name, so that unknown accounts are refused without a query
+    sAccountNameFilter.Initialize(sConfig.GetIntDefault("AccountFilter.RefreshInterval", 5), sConfig.GetIntDefault("AccountFilter.ReloadInterval", 600),
+                                  size_t(sConfig.GetIntDefault("AccountFilter.NegativeCacheSize", 65536)));
+
+    ///- Character counts of the accounts sitting on the realm screen
+    sCharacterCountCache.Initialize(sConfig.GetIntDefault("CharacterCountCache.TTL", 10), size_t(sConfig.GetIntDefault("CharacterCountCache.MaxEntries", 16384)));
+
+    ///- Launch the network threads, 0 means one per hardware thread
+    int networkThreads = sConfig.GetIntDefault("NetworkThreads", 1);
+    if (networkThreads <= 0)
+        networkThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    AuthSocket::LoadTimeouts();
+
+    ///- Build the SRP6 fixed-base table before the first client needs it
+    SRP6Params::Instance();
+
+    ///- Optional crypto threads for the logon proof exponentiations, created before the network threads use them
+    std::unique_ptr<MaNGOS::WorkerPool> cryptoPool;
+    int const cryptoThreads = sConfig.GetIntDefault("CryptoThreads", 0);
+    if (cryptoThreads > 0)
+    {
+        cryptoPool.reset(new MaNGOS::WorkerPool(cryptoThreads));
+        AuthSocket::SetCryptoPool(cryptoPool.get());
+        sLog.outString("Using %u crypto thread(s)", uint32(cryptoPool->WorkerCount()));
+    }
+
+    ///- Connection admission, checked before a session is created
+    MaNGOS::ConnectionLimits limits;
+    limits.maxTotal = sConfig.GetIntDefault("MaxConnections", 0);
+    limits.maxPerAddress = sConfig.GetIntDefault("MaxConnectionsPerIP", 0);
+    limits.newPerSecondPerAddress = sConfig.GetIntDefault("NewConnectionsPerIP.Rate", 0);
+    limits.burstPerAddress = sConfig.GetIntDefault("NewConnectionsPerIP.Burst", 10);
+
+    MaNGOS::Listener<AuthSocket> listener(sConfig.GetStringDefault("BindIP", "0.0.0.0"), sConfig.GetIntDefault("RealmServerPort", DEFAULT_REALMSERVER_PORT),
+                                          networkThreads, sConfig.GetBoolDefault("NetworkThreadsAffinity", false),
+                                          sConfig.GetBoolDefault("NetworkReusePort", false), limits);
+
+    sLog.outString("Using %u network thread(s)%s", uint32(listener.WorkerCount()), listener.IsReusePort() ? " with SO_REUSEPORT acceptors" : "");
 
     ///- Catch termination signals
     HookSignals();
@@ -221,6 +273,10 @@ int main(int argc, char* argv[])
     auto const numLoops = sConfig.GetIntDefault("MaxPingTime", 30) * MINUTE * 10;
     uint32 loopCounter = 0;
 
+    // network statistics are logged every statsLoops loops, 0 disables them
+    auto const statsLoops = sConfig.GetIntDefault("StatsLogInterval", 0) * 10;
+    int statsCounter = 0;
+
 #ifndef _WIN32
     detachDaemon();
 #endif
@@ -233,9 +289,72 @@ int main(int argc, char* argv[])
             DETAIL_LOG("Ping MySQL to keep connection alive");
             LoginDatabase.Ping();
         }
+
+        sRealmList.UpdateIfNeed();
+        sBanCache.UpdateIfNeed();
+        sAccountNameFilter.UpdateIfNeed();
+
+        if (statsLoops > 0 && (++statsCounter) >= statsLoops)
+        {
+            statsCounter = 0;
+
+            auto const poolStats = listener.GetBufferPoolStats();
+            auto const requests = poolStats.hits + poolStats.misses;
+
+            sLog.outString("Network buffers: %.1f%% pool hits (" UI64FMTD " requests), " UI64FMTD " bytes resident, " UI64FMTD " bytes in use",
+                           requests ? 100.0 * poolStats.hits / requests : 100.0, requests, poolStats.residentBytes, poolStats.lentBytes);
+            sLog.outString("Network connections: " UI64FMTD " rejected by admission control, " UI64FMTD " bytes held in buffers, " UI64FMTD " input bytes dropped",
+                           listener.GetRejectedConnections(), MaNGOS::Socket::GetTotalMemoryUsage(), MaNGOS::Socket::GetTotalDroppedInput());
+
+            if (cryptoPool)
+            {
+                auto const cryptoStats = cryptoPool->GetStats();
+                sLog.outString("Crypto pool: " UI64FMTD " queued, " UI64FMTD " executed (" UI64FMTD " stolen), %.1f us average wait, " UI64FMTD " us max wait",
+                               cryptoStats.queued, cryptoStats.executed, cryptoStats.stolen,
+                               cryptoStats.executed ? double(cryptoStats.totalWaitMicroseconds) / cryptoStats.executed : 0.0, cryptoStats.maxWaitMicroseconds);
+            }
+
+            if (sAccountCache.IsEnabled())
+            {
+                auto const cacheStats = sAccountCache.GetStats();
+                auto const lookups = cacheStats.hits + cacheStats.misses;
+                sLog.outString("Account cache: %.1f%% hits (" UI64FMTD " lookups), " UI64FMTD " evicted, " UI64FMTD " expired, " UI64FMTD " accounts in " UI64FMTD " bytes",
+                               lookups ? 100.0 * cacheStats.hits / lookups : 0.0, lookups, cacheStats.evictions, cacheStats.expirations, cacheStats.entries, cacheStats.bytes);
+            }
+
+            if (sCharacterCountCache.IsEnabled())
+            {
+                auto const countStats = sCharacterCountCache.GetStats();
+                auto const lookups = countStats.hits + countStats.misses;
+                sLog.outString("Character count cache: %.1f%% hits (" UI64FMTD " realm lists), " UI64FMTD " accounts",
+                               lookups ? 100.0 * countStats.hits / lookups : 0.0, lookups, countStats.entries);
+            }
+
+            if (sAccountNameFilter.IsEnabled())
+            {
+                auto const filterStats = sAccountNameFilter.GetStats();
+                auto const unknown = filterStats.rejected + filterStats.negativeHits + filterStats.falsePositives;
+                sLog.outString("Account filter: " UI64FMTD " names in " UI64FMTD " bytes, %.3f%% expected false positives, %.3f%% observed (" UI64FMTD " unknown logins, " UI64FMTD " refused without a query), " UI64FMTD " negative entries in " UI64FMTD " bytes",
+                               filterStats.names, filterStats.filterBytes, filterStats.expectedFalsePositiveRate * 100.0,
+                               unknown ? 100.0 * (filterStats.falsePositives + filterStats.negativeHits) / unknown : 0.0, unknown, filterStats.rejected + filterStats.negativeHits,
+                               filterStats.negativeEntries, filterStats.negativeBytes);
+            }
+
+            if (MaNGOS::WorkerPool const* queryThreads = LoginDatabase.GetQueryThreads())
+            {
+                auto const queryStats = queryThreads->GetStats();
+                sLog.outString("Database queries: " UI64FMTD " queued, " UI64FMTD " executed, %.1f us average wait, " UI64FMTD " us max wait",
+                               queryStats.queued, queryStats.executed,
+                               queryStats.executed ? double(queryStats.totalWaitMicroseconds) / queryStats.executed : 0.0, queryStats.maxWaitMicroseconds);
+            }
+        }
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
 
+    ///- Queued proofs are dropped while the network threads still exist
+    if (cryptoPool)
+        cryptoPool->Stop();
+
     ///- Wait for the delay thread to exit
     LoginDatabase.HaltDelayThread();
 
@@ -24,40 +24,7 @@
 
 extern DatabaseType LoginDatabase;
 
-// will only support WoW 1.12.1/1.12.2/1.12.3 , WoW:TBC 2.4.3 and official release for WoW:WotLK and later, client builds 10505, 8606, 6141, 6005, 5875
-// if you need more from old build then add it in cases in realmd sources code
-// list sorted from high to low build and first build used as low bound for accepted by default range (any > it will accepted by realmd at least)
-
-static const RealmBuildInfo ExpectedRealmdClientBuilds[] =
-{
-    {12340, 3, 3, 5, 'a'},                                  // highest supported build, also auto accept all above for simplify future supported builds testing
-    {11723, 3, 3, 3, 'a'},
-    {11403, 3, 3, 2, ' '},
-    {11159, 3, 3, 0, 'a'},
-    {10505, 3, 2, 2, 'a'},
-    {8606,  2, 4, 3, ' '},
-    {6141,  1, 12, 3, ' '},
-    {6005,  1, 12, 2, ' '},
-    {5875,  1, 12, 1, ' '},
-    {0,     0, 0, 0, ' '}                                   // terminator
-};
-
-RealmBuildInfo const* FindBuildInfo(uint16 _build)
-{
-    // first build is low bound of always accepted range
-    if (_build >= ExpectedRealmdClientBuilds[0].build)
-        return &ExpectedRealmdClientBuilds[0];
-
-    // continue from 1 with explicit equal check
-    for (int i = 1; ExpectedRealmdClientBuilds[i].build; ++i)
-        if (_build == ExpectedRealmdClientBuilds[i].build)
-            return &ExpectedRealmdClientBuilds[i];
-
-    // none appropriate build
-    return nullptr;
-}
-
-RealmList::RealmList() : m_UpdateInterval(0), m_NextUpdateTime(time(nullptr))
+RealmList::RealmList() : m_snapshot(std::make_shared<Snapshot>()), m_UpdateInterval(0), m_NextUpdateTime(time(nullptr))
 {
 }
 
@@ -71,15 +38,16 @@ RealmList& sRealmList
 void RealmList::Initialize(uint32 updateInterval)
 {
     m_UpdateInterval = updateInterval;
+    m_NextUpdateTime = time(nullptr) + m_UpdateInterval;
 
     ///- Get the content of the realmlist table in the database
     UpdateRealms(true);
 }
 
-void RealmList::UpdateRealm(uint32 ID, const std::string& name, const std::string& address, uint32 port, uint8 icon, RealmFlags realmflags, uint8 timezone, AccountTypes allowedSecurityLevel, float popu, const std::string& builds)
+void RealmList::UpdateRealm(RealmMap& realms, uint32 ID, const std::string& name, const std::string& address, uint32 port, uint8 icon, RealmFlags realmflags, uint8 timezone, AccountTypes allowedSecurityLevel, float popu, const std::string& builds)
 {
     ///- Create new if not exist or update existed
-    Realm& realm = m_realms[name];
+    Realm& realm = realms[name];
 
     realm.m_ID       = ID;
     realm.icon       = icon;
@@ -124,10 +92,7 @@ void RealmList::UpdateIfNeed()
 
     m_NextUpdateTime = time(nullptr) + m_UpdateInterval;
 
-    // Clears Realm list
-    m_realms.clear();
-
-    // Get the content of the realmlist table in the database
+    // Get the content of the realmlist table in the database, the current list is served meanwhile
     UpdateRealms(false);
 }
 
@@ -135,6 +100,8 @@ void RealmList::UpdateRealms(bool init)
 {
     DETAIL_LOG("Updating Realm List...");
 
+    std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>();
+
     ////                                               0   1     2        3     4     5           6         7                     8           9
     QueryResult* result = LoginDatabase.Query("SELECT Id, Name, Address, Port, Icon, RealmFlags, TimeZone, AllowedSecurityLevel, Population, RealmBuilds FROM realm_list WHERE (RealmFlags & 1) = 0 ORDER BY Name");
 
@@ -156,7 +123,7 @@ void RealmList::UpdateRealms(bool init)
                 realmflags &= (REALM_FLAG_OFFLINE | REALM_FLAG_NEW_PLAYERS | REALM_FLAG_RECOMMENDED | REALM_FLAG_SPECIFYBUILD);
             }
 
-            UpdateRealm(
+            UpdateRealm(snapshot->realms,
                 Id, name, fields[2].GetCppString(), fields[3].GetUInt32(),
                 fields[4].GetUInt8(), RealmFlags(realmflags), fields[6].GetUInt8(),
                 (allowedSecurityLevel <= SEC_ADMINISTRATOR ? AccountTypes(allowedSecurityLevel) : SEC_ADMINISTRATOR),
@@ -168,4 +135,15 @@ void RealmList::UpdateRealms(bool init)
         while (result->NextRow());
         delete result;
     }
+
+    for (uint16 build : RealmListPacket::RenderedBuilds(snapshot->realms))
+        snapshot->packets.insert(std::make_pair(build, RealmListPacket(snapshot->realms, build)));
+
+    std::atomic_store(&m_snapshot, SnapshotPtr(snapshot));
+}
+
+RealmListPacket const* RealmList::Snapshot::GetPacket(uint16 build) const
+{
+    std::map<uint16, RealmListPacket>::const_iterator found = packets.find(build);
+    return found != packets.end() ? &found->second : nullptr;
 }
@@ -25,6 +25,13 @@
 
 #include "Common.h"
 
+#include <memory>
+#include <set>
+#include <utility>
+#include <vector>
+
+class ByteBuffer;
+
 struct RealmBuildInfo
 {
     int build;
@@ -52,11 +59,75 @@ struct Realm
     RealmBuildInfo realmBuildInfo;                          // build info for show version in list
 };
 
-/// Storage object for the list of realms on the server
+typedef std::map<std::string, Realm> RealmMap;
+
+/// Characters of an account by realm id, a few entries kept sorted in one vector
+class CharacterCounts
+{
+    public:
+        void Set(uint32 realmId, uint8 count);
+
+        /// 0 for the realms without characters of the account
+        uint8 Get(uint32 realmId) const;
+
+    private:
+        typedef std::pair<uint32, uint8> Count;
+
+        std::vector<Count> m_counts;
+};
+
+/// The realm list answer for one client build, rendered when the realms are loaded.  Answering an
+/// account copies the bytes and writes its character counts and locked realms at recorded offsets.
+class RealmListPacket
+{
+    public:
+        RealmListPacket(RealmMap const& realms, uint16 build);
+
+        /// The answer for an account, header included
+        void Write(std::vector<uint8>& packet, CharacterCounts const& characters, AccountTypes security) const;
+
+        /// Renders the answer for an account field by field, for the builds without a rendered packet
+        static void Render(ByteBuffer& pkt, RealmMap const& realms, uint16 build, CharacterCounts const& characters, AccountTypes security);
+
+        /// Every build accepted by the logon challenge or supported by one of the realms
+        static std::set<uint16> RenderedBuilds(RealmMap const& realms);
+
+    private:
+        /// The bytes of one realm depending on the account
+        struct Patch
+        {
+            uint32 realmId;
+            AccountTypes allowedSecurityLevel;
+            size_t charactersOffset;
+            size_t lockOffset;
+            uint8 lockMask;                                 ///< or'ed into the lock byte for the accounts below allowedSecurityLevel
+        };
+
+        static void Render(ByteBuffer& pkt, RealmMap const& realms, uint16 build, CharacterCounts const& characters, AccountTypes security, std::vector<Patch>* patches);
+
+        std::vector<uint8> m_bytes;
+        std::vector<Patch> m_patches;
+};
+
+/// Storage object for the list of realms on the server.
+/// Every reload builds a new snapshot and publishes it with one atomic store, readers keep the
+/// version they loaded for as long as they use it and never wait for the database.
 class RealmList
 {
     public:
-        typedef std::map<std::string, Realm> RealmMap;
+        typedef ::RealmMap RealmMap;
+
+        /// One version of the realm list, never modified once published
+        struct Snapshot
+        {
+            RealmMap realms;
+            std::map<uint16, RealmListPacket> packets;      ///< answers by client build
+
+            /// The rendered answer for build, nullptr for the builds rendered on request
+            RealmListPacket const* GetPacket(uint16 build) const;
+        };
+
+        typedef std::shared_ptr<Snapshot const> SnapshotPtr;
 
         static RealmList& Instance();
 
@@ -65,16 +136,17 @@ class RealmList
 
         void Initialize(uint32 updateInterval);
 
+        /// Called regularly by the main thread, reloads the realms once the update interval has passed
         void UpdateIfNeed();
 
-        RealmMap::const_iterator begin() const { return m_realms.begin(); }
-        RealmMap::const_iterator end() const { return m_realms.end(); }
-        uint32 size() const { return m_realms.size(); }
+        SnapshotPtr GetSnapshot() const { return std::atomic_load(&m_snapshot); }
+
+        uint32 size() const { return GetSnapshot()->realms.size(); }
     private:
         void UpdateRealms(bool init);
-        void UpdateRealm(uint32 ID, const std::string& name, const std::string& address, uint32 port, uint8 icon, RealmFlags realmflags, uint8 timezone, AccountTypes allowedSecurityLevel, float popu, const std::string& builds);
+        static void UpdateRealm(RealmMap& realms, uint32 ID, const std::string& name, const std::string& address, uint32 port, uint8 icon, RealmFlags realmflags, uint8 timezone, AccountTypes allowedSecurityLevel, float popu, const std::string& builds);
     private:
-        RealmMap m_realms;                                  ///< Internal map of realms
+        SnapshotPtr m_snapshot;                             ///< only accessed through std::atomic_load and std::atomic_store
         uint32   m_UpdateInterval;
         time_t   m_NextUpdateTime;
 };
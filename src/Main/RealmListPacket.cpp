@@ -0,0 +1,246 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/** \file
+    \ingroup realmd
+    The realm list answer, apart from the database so that auth_bench can time it.
+*/
+
+#include "Common.h"
+#include "RealmList.h"
+#include "AuthCodes.h"
+#include "ByteBuffer/ByteBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+// will only support WoW 1.12.1/1.12.2/1.12.3 , WoW:TBC 2.4.3 and official release for WoW:WotLK and later, client builds 10505, 8606, 6141, 6005, 5875
+// if you need more from old build then add it in cases in realmd sources code
+// list sorted from high to low build and first build used as low bound for accepted by default range (any > it will accepted by realmd at least)
+
+static const RealmBuildInfo ExpectedRealmdClientBuilds[] =
+{
+    {12340, 3, 3, 5, 'a'},                                  // highest supported build, also auto accept all above for simplify future supported builds testing
+    {11723, 3, 3, 3, 'a'},
+    {11403, 3, 3, 2, ' '},
+    {11159, 3, 3, 0, 'a'},
+    {10505, 3, 2, 2, 'a'},
+    {8606,  2, 4, 3, ' '},
+    {6141,  1, 12, 3, ' '},
+    {6005,  1, 12, 2, ' '},
+    {5875,  1, 12, 1, ' '},
+    {0,     0, 0, 0, ' '}                                   // terminator
+};
+
+RealmBuildInfo const* FindBuildInfo(uint16 _build)
+{
+    // first build is low bound of always accepted range
+    if (_build >= ExpectedRealmdClientBuilds[0].build)
+        return &ExpectedRealmdClientBuilds[0];
+
+    // continue from 1 with explicit equal check
+    for (int i = 1; ExpectedRealmdClientBuilds[i].build; ++i)
+        if (_build == ExpectedRealmdClientBuilds[i].build)
+            return &ExpectedRealmdClientBuilds[i];
+
+    // none appropriate build
+    return nullptr;
+}
+
+void CharacterCounts::Set(uint32 realmId, uint8 count)
+{
+    auto const itr = std::lower_bound(m_counts.begin(), m_counts.end(), Count(realmId, 0));
+    if (itr != m_counts.end() && itr->first == realmId)
+        itr->second = count;
+    else
+        m_counts.insert(itr, Count(realmId, count));
+}
+
+uint8 CharacterCounts::Get(uint32 realmId) const
+{
+    auto const itr = std::lower_bound(m_counts.begin(), m_counts.end(), Count(realmId, 0));
+    return itr != m_counts.end() && itr->first == realmId ? itr->second : 0;
+}
+
+RealmListPacket::RealmListPacket(RealmMap const& realms, uint16 build)
+{
+    // rendered for an account without characters for which no realm is locked, the patches write the others
+    ByteBuffer pkt;
+    Render(pkt, realms, build, CharacterCounts(), SEC_ADMINISTRATOR, &m_patches);
+
+    m_bytes.assign(pkt.contents(), pkt.contents() + pkt.size());
+}
+
+void RealmListPacket::Write(std::vector<uint8>& packet, CharacterCounts const& characters, AccountTypes security) const
+{
+    packet.resize(m_bytes.size());
+    memcpy(packet.data(), m_bytes.data(), m_bytes.size());
+
+    for (Patch const& patch : m_patches)
+    {
+        packet[patch.charactersOffset] = characters.Get(patch.realmId);
+        if (patch.allowedSecurityLevel > security)
+            packet[patch.lockOffset] |= patch.lockMask;
+    }
+}
+
+void RealmListPacket::Render(ByteBuffer& pkt, RealmMap const& realms, uint16 build, CharacterCounts const& characters, AccountTypes security)
+{
+    Render(pkt, realms, build, characters, security, nullptr);
+}
+
+std::set<uint16> RealmListPacket::RenderedBuilds(RealmMap const& realms)
+{
+    std::set<uint16> builds;
+
+    for (int i = 0; ExpectedRealmdClientBuilds[i].build; ++i)
+        builds.insert(ExpectedRealmdClientBuilds[i].build);
+
+    for (RealmMap::const_iterator i = realms.begin(); i != realms.end(); ++i)
+        for (uint32 build : i->second.realmbuilds)
+            if (FindBuildInfo(build))
+                builds.insert(build);
+
+    return builds;
+}
+
+void RealmListPacket::Render(ByteBuffer& pkt, RealmMap const& realms, uint16 build, CharacterCounts const& characters, AccountTypes security, std::vector<Patch>* patches)
+{
+    pkt << (uint8) CMD_REALM_LIST;
+    pkt << (uint16) 0;                                      // size, written at the end
+
+    switch (build)
+    {
+        case 5875:                                          // 1.12.1
+        case 6005:                                          // 1.12.2
+        case 6141:                                          // 1.12.3
+        {
+            pkt << uint32(0);                               // unused value
+            pkt << uint8(realms.size());
+
+            for (RealmMap::const_iterator  i = realms.begin(); i != realms.end(); ++i)
+            {
+                uint8 AmountOfCharacters = characters.Get(i->second.m_ID);
+
+                bool ok_build = std::find(i->second.realmbuilds.begin(), i->second.realmbuilds.end(), build) != i->second.realmbuilds.end();
+
+                RealmBuildInfo const* buildInfo = ok_build ? FindBuildInfo(build) : nullptr;
+                if (!buildInfo)
+                    buildInfo = &i->second.realmBuildInfo;
+
+                RealmFlags realmflags = i->second.realmflags;
+
+                // 1.x clients not support explicitly REALM_FLAG_SPECIFYBUILD, so manually form similar name as show in more recent clients
+                std::string name = i->first;
+                if (realmflags & REALM_FLAG_SPECIFYBUILD)
+                {
+                    char buf[20];
+                    snprintf(buf, 20, " (%u,%u,%u)", buildInfo->major_version, buildInfo->minor_version, buildInfo->bugfix_version);
+                    name += buf;
+                }
+
+                // Show offline state for unsupported client builds and locked realms (1.x clients not support locked state show)
+                if (!ok_build || (i->second.allowedSecurityLevel > security))
+                    realmflags = RealmFlags(realmflags | REALM_FLAG_OFFLINE);
+
+                Patch patch = { i->second.m_ID, i->second.allowedSecurityLevel, 0, 0, uint8(REALM_FLAG_OFFLINE) };
+
+                pkt << uint32(i->second.icon);              // realm type
+                patch.lockOffset = pkt.wpos();
+                pkt << uint8(realmflags);                   // realmflags
+                pkt << name;                                // name
+                pkt << i->second.address;                   // address
+                pkt << float(i->second.populationLevel);
+                patch.charactersOffset = pkt.wpos();
+                pkt << uint8(AmountOfCharacters);
+                pkt << uint8(i->second.timezone);           // realm category
+                pkt << uint8(0x00);                         // unk, may be realm number/id?
+
+                if (patches)
+                    patches->push_back(patch);
+            }
+
+            pkt << uint16(0x0002);                          // unused value (why 2?)
+            break;
+        }
+
+        case 8606:                                          // 2.4.3
+        case 10505:                                         // 3.2.2a
+        case 11159:                                         // 3.3.0a
+        case 11403:                                         // 3.3.2
+        case 11723:                                         // 3.3.3a
+        case 12340:                                         // 3.3.5a
+        default:                                            // and later
+        {
+            pkt << uint32(0);                               // unused value
+            pkt << uint16(realms.size());
+
+            for (RealmMap::const_iterator  i = realms.begin(); i != realms.end(); ++i)
+            {
+                uint8 AmountOfCharacters = characters.Get(i->second.m_ID);
+
+                bool ok_build = std::find(i->second.realmbuilds.begin(), i->second.realmbuilds.end(), build) != i->second.realmbuilds.end();
+
+                RealmBuildInfo const* buildInfo = ok_build ? FindBuildInfo(build) : nullptr;
+                if (!buildInfo)
+                    buildInfo = &i->second.realmBuildInfo;
+
+                uint8 lock = (i->second.allowedSecurityLevel > security) ? 1 : 0;
+
+                RealmFlags realmFlags = i->second.realmflags;
+
+                // Show offline state for unsupported client builds
+                if (!ok_build)
+                    realmFlags = RealmFlags(realmFlags | REALM_FLAG_OFFLINE);
+
+                //if (!buildInfo) // always false since updated 10 lines above if null. ToDo: fix
+                //    realmFlags = RealmFlags(realmFlags & ~REALM_FLAG_SPECIFYBUILD);
+
+                Patch patch = { i->second.m_ID, i->second.allowedSecurityLevel, 0, 0, uint8(0x01) };
+
+                pkt << uint8(i->second.icon);               // realm type (this is second column in Cfg_Configs.dbc)
+                patch.lockOffset = pkt.wpos();
+                pkt << uint8(lock);                         // flags, if 0x01, then realm locked
+                pkt << uint8(realmFlags);                   // see enum RealmFlags
+                pkt << i->first;                            // name
+                pkt << i->second.address;                   // address
+                pkt << float(i->second.populationLevel);
+                patch.charactersOffset = pkt.wpos();
+                pkt << uint8(AmountOfCharacters);
+                pkt << uint8(i->second.timezone);           // realm category (Cfg_Categories.dbc)
+                pkt << uint8(0x2C);                         // unk, may be realm number/id?
+
+                if (realmFlags & REALM_FLAG_SPECIFYBUILD)
+                {
+                    pkt << uint8(buildInfo->major_version);
+                    pkt << uint8(buildInfo->minor_version);
+                    pkt << uint8(buildInfo->bugfix_version);
+                    pkt << uint16(build);
+                }
+
+                if (patches)
+                    patches->push_back(patch);
+            }
+
+            pkt << uint16(0x0010);                          // unused value (why 10?)
+            break;
+        }
+    }
+
+    pkt.put<uint16>(1, uint16(pkt.size() - 3));
+}
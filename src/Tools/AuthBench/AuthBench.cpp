@@ -0,0 +1,900 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/** \file
+    Micro-benchmarks of the authentication hot paths. Every optimized path is checked
+    against the reference implementation before it is timed.
+*/
+
+#include "Common.h"
+#include "Auth/BigNumber.h"
+#include "Auth/Mont256.h"
+#include "Auth/SRP6Params.h"
+#include "Auth/Sha1.h"
+#include "Auth/Sha1Batch.h"
+#include "Database/DatabaseEnv.h"
+#include "ByteBuffer/ByteBuffer.h"
+#include "Network/Listener.hpp"
+#include "RealmList.h"
+
+#include <boost/program_options.hpp>
+#include <openssl/bn.h>
+
+#include <openssl/crypto.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // every timed result is folded in here, so that the compiler cannot drop the work
+    volatile int g_sink = 0;
+
+    inline void Consume(int value)
+    {
+        g_sink = g_sink + value;
+    }
+
+    struct Benchmark
+    {
+        std::string name;
+        std::function<bool ()> check;                       ///< false when the optimized path disagrees with the reference
+        std::function<void (size_t)> reference;
+        std::function<void (size_t)> optimized;
+    };
+
+    double NanosecondsPerCall(std::function<void (size_t)> const& fn, size_t iterations)
+    {
+        fn(iterations / 10 + 1);                            // warm up
+
+        const auto start = std::chrono::steady_clock::now();
+        fn(iterations);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    }
+
+    std::vector<BigNumber> RandomNumbers(size_t count, int bits)
+    {
+        std::vector<BigNumber> numbers(count);
+        for (auto& number : numbers)
+            number.SetRand(bits);
+        return numbers;
+    }
+
+    bool SameNumber(BigNumber& left, BigNumber& right)
+    {
+        return left.GetNumBytes() == right.GetNumBytes() && !memcmp(left.AsByteArray(), right.AsByteArray(), left.GetNumBytes());
+    }
+
+    // g^b mod N as computed for B in the logon challenge (b has 152 bits, x in the verifier has 160)
+    Benchmark ModExpG(int bits)
+    {
+        auto exponents = std::make_shared<std::vector<BigNumber>>(RandomNumbers(256, bits));
+
+        Benchmark benchmark;
+        benchmark.name = bits == 152 ? "g^b mod N (152 bit)" : "g^x mod N (160 bit)";
+
+        benchmark.check = [exponents] ()
+        {
+            BigNumber g = sSRP6Params.GetG();
+            for (auto& exponent : *exponents)
+            {
+                BigNumber expected = g.ModExp(exponent, sSRP6Params.GetN());
+                BigNumber result = sSRP6Params.ModExpG(exponent);
+                if (!SameNumber(expected, result))
+                    return false;
+            }
+            return true;
+        };
+
+        benchmark.reference = [exponents] (size_t iterations)
+        {
+            BigNumber g = sSRP6Params.GetG();
+            for (size_t i = 0; i < iterations; ++i)
+                Consume(g.ModExp((*exponents)[i % exponents->size()], sSRP6Params.GetN()).GetNumBytes());
+        };
+
+        benchmark.optimized = [exponents] (size_t iterations)
+        {
+            for (size_t i = 0; i < iterations; ++i)
+                Consume(sSRP6Params.ModExpG((*exponents)[i % exponents->size()]).GetNumBytes());
+        };
+
+        return benchmark;
+    }
+
+    BigNumber FromMont256(Mont256::Element const& element)
+    {
+        uint8 bytes[Mont256::Bytes];
+        sSRP6Params.GetMont256().ToBytes(bytes, element);
+
+        BigNumber number;
+        number.SetBinary(bytes, Mont256::Bytes);
+        return number;
+    }
+
+    // random values below 2^256 with the edges of the Montgomery reduction mixed in
+    std::vector<BigNumber> Mont256Inputs(size_t count)
+    {
+        BigNumber N = sSRP6Params.GetN();
+
+        std::vector<BigNumber> inputs = RandomNumbers(count, 256);
+        inputs.push_back(BigNumber(0));
+        inputs.push_back(BigNumber(1));
+        inputs.push_back(N - BigNumber(1));
+        inputs.push_back(N);
+        inputs.push_back(N + BigNumber(1));
+
+        BigNumber max;
+        max.SetHexStr("FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF");
+        inputs.push_back(max);
+
+        std::mt19937 random(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            BigNumber small;
+            small.SetRand(1 + random() % 255);
+            inputs.push_back(small);
+        }
+
+        return inputs;
+    }
+
+    /// Randomized known answers: Add, Mul and ModExp of Mont256 against OpenSSL
+    bool CheckMont256()
+    {
+        Mont256 const& mont = sSRP6Params.GetMont256();
+        BigNumber N = sSRP6Params.GetN();
+
+        std::vector<BigNumber> inputs = Mont256Inputs(200);
+        std::mt19937 random(42);
+
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            BigNumber a = inputs[i];
+            BigNumber b = inputs[random() % inputs.size()];
+
+            Mont256::Element ma, mb, mr;
+            if (!mont.FromBytes(ma, a.AsByteArray(32), 32) || !mont.FromBytes(mb, b.AsByteArray(32), 32))
+                return false;
+
+            BigNumber expected = (a + b) % N;
+            mont.Add(mr, ma, mb);
+            BigNumber result = FromMont256(mr);
+            if (!SameNumber(expected, result))
+                return false;
+
+            expected = (a * b) % N;
+            mont.Mul(mr, ma, mb);
+            result = FromMont256(mr);
+            if (!SameNumber(expected, result))
+                return false;
+
+            // exponents of every length up to 32 bytes, leading zero bytes included
+            const int len = 1 + random() % Mont256::Bytes;
+            uint8 exponent[Mont256::Bytes];
+            for (int j = 0; j < len; ++j)
+                exponent[j] = uint8(random());
+
+            BigNumber e;
+            e.SetBinary(exponent, len);
+            expected = a.ModExp(e, N);
+            mont.ModExp(mr, ma, exponent, len);
+            result = FromMont256(mr);
+            if (!SameNumber(expected, result))
+                return false;
+        }
+
+        return true;
+    }
+
+    // K as stored in the session key column
+    Benchmark HexSessionKey()
+    {
+        auto key = std::make_shared<BigNumber>(RandomNumbers(1, 40 * 8)[0]);
+
+        Benchmark benchmark;
+        benchmark.name = "hex of K (40 bytes)";
+
+        benchmark.check = [key] ()
+        {
+            for (int bits = 1; bits <= 40 * 8; ++bits)
+            {
+                BigNumber number = RandomNumbers(1, bits)[0];
+                char hex[40 * 2 + 1];
+                const char* expected = number.AsHexStr();
+                const bool same = number.WriteHexStr(hex, sizeof(hex)) && !strcmp(expected, hex);
+                OPENSSL_free((void*)expected);
+                if (!same)
+                    return false;
+            }
+            return true;
+        };
+
+        benchmark.reference = [key] (size_t iterations)
+        {
+            for (size_t i = 0; i < iterations; ++i)
+            {
+                const char* hex = key->AsHexStr();
+                Consume(hex[0]);
+                OPENSSL_free((void*)hex);
+            }
+        };
+
+        benchmark.optimized = [key] (size_t iterations)
+        {
+            for (size_t i = 0; i < iterations; ++i)
+            {
+                char hex[40 * 2 + 1];
+                key->WriteHexStr(hex, sizeof(hex));
+                Consume(hex[0]);
+            }
+        };
+
+        return benchmark;
+    }
+
+    struct ProofInput
+    {
+        uint8 A[32];
+        BigNumber v;
+        uint8 u[20];
+        BigNumber b;
+    };
+
+    // S = (A * v^u) ^ b of the logon proof
+    Benchmark ProofS()
+    {
+        auto inputs = std::make_shared<std::vector<ProofInput>>(64);
+        for (auto& input : *inputs)
+        {
+            BigNumber A;
+            A.SetRand(256);
+            memcpy(input.A, A.AsByteArray(32), 32);
+            input.v = sSRP6Params.ModExpG(RandomNumbers(1, 160)[0]);
+            BigNumber u;
+            u.SetRand(160);
+            memcpy(input.u, u.AsByteArray(20), 20);
+            input.b.SetRand(19 * 8);
+        }
+
+        auto reference = [] (ProofInput& input, uint8* S)
+        {
+            BigNumber A, u;
+            A.SetBinary(input.A, 32);
+            u.SetBinary(input.u, 20);
+            BigNumber result = (A * (input.v.ModExp(u, sSRP6Params.GetN()))).ModExp(input.b, sSRP6Params.GetN());
+            memcpy(S, result.AsByteArray(32), 32);
+        };
+
+        auto optimized = [] (ProofInput& input, uint8* S)
+        {
+            Mont256 const& mont = sSRP6Params.GetMont256();
+            Mont256::Element montA, montS;
+            mont.FromBytes(montA, input.A, 32);
+            mont.FromBytes(montS, input.v.AsByteArray(), input.v.GetNumBytes());
+            mont.ModExp(montS, montS, input.u, 20);
+            mont.Mul(montS, montA, montS);
+            mont.ModExp(montS, montS, input.b.AsByteArray(), input.b.GetNumBytes());
+            mont.ToBytes(S, montS);
+        };
+
+        Benchmark benchmark;
+        benchmark.name = "proof S (A * v^u)^b";
+
+        benchmark.check = [inputs, reference, optimized] ()
+        {
+            if (!CheckMont256())
+                return false;
+
+            for (auto& input : *inputs)
+            {
+                uint8 expected[32], result[32];
+                reference(input, expected);
+                optimized(input, result);
+                if (memcmp(expected, result, 32))
+                    return false;
+            }
+            return true;
+        };
+
+        benchmark.reference = [inputs, reference] (size_t iterations)
+        {
+            uint8 S[32];
+            for (size_t i = 0; i < iterations; ++i)
+                reference((*inputs)[i % inputs->size()], S);
+        };
+
+        benchmark.optimized = [inputs, optimized] (size_t iterations)
+        {
+            uint8 S[32];
+            for (size_t i = 0; i < iterations; ++i)
+                optimized((*inputs)[i % inputs->size()], S);
+        };
+
+        return benchmark;
+    }
+
+    // independent SHA1 of the logon proof: halves of S (16 bytes), M2 (92 bytes) and M (176 bytes)
+    Benchmark Sha1(int length)
+    {
+        const int count = Sha1Batch::MaxLanes;
+        auto messages = std::make_shared<std::vector<uint8>>(count * length);
+        std::mt19937 random(length);
+        for (auto& byte : *messages)
+            byte = uint8(random());
+
+        Benchmark benchmark;
+        benchmark.name = "sha1 " + std::to_string(length) + " bytes (" + Sha1Batch::Implementation() + ")";
+
+        benchmark.check = [] ()
+        {
+            // every length the lanes take and some beyond, groups of every size
+            std::mt19937 random(7);
+            std::vector<uint8> data(Sha1Batch::MaxLaneLength + 64);
+            for (auto& byte : data)
+                byte = uint8(random());
+
+            for (int length = 0; length < int(data.size()); ++length)
+            {
+                const int count = 1 + length % (2 * Sha1Batch::MaxLanes + 1);
+                std::vector<uint8 const*> messages(count);
+                std::vector<int> lengths(count);
+                for (int i = 0; i < count; ++i)
+                {
+                    lengths[i] = (length + i * 37) % data.size();
+                    messages[i] = &data[data.size() - lengths[i]];
+                }
+
+                std::vector<uint8> digests(count * SHA_DIGEST_LENGTH);
+                Sha1Batch::Hash(&messages[0], &lengths[0], count, &digests[0]);
+
+                for (int i = 0; i < count; ++i)
+                {
+                    uint8 expected[SHA_DIGEST_LENGTH];
+                    SHA1(messages[i], lengths[i], expected);
+                    if (memcmp(expected, &digests[i * SHA_DIGEST_LENGTH], SHA_DIGEST_LENGTH))
+                        return false;
+                }
+            }
+            return true;
+        };
+
+        benchmark.reference = [messages, length, count] (size_t iterations)
+        {
+            Sha1Hash sha;
+            for (size_t i = 0; i < iterations; ++i)
+            {
+                sha.Initialize();
+                sha.UpdateData(&(*messages)[(i % count) * length], length);
+                sha.Finalize();
+            }
+        };
+
+        // one iteration is one hash, as for the reference
+        benchmark.optimized = [messages, length, count] (size_t iterations)
+        {
+            uint8 const* pointers[Sha1Batch::MaxLanes];
+            int lengths[Sha1Batch::MaxLanes];
+            uint8 digests[Sha1Batch::MaxLanes * SHA_DIGEST_LENGTH];
+            for (int i = 0; i < count; ++i)
+            {
+                pointers[i] = &(*messages)[i * length];
+                lengths[i] = length;
+            }
+
+            for (size_t i = 0; i < iterations; i += count)
+                Sha1Batch::Hash(pointers, lengths, count, digests);
+        };
+
+        return benchmark;
+    }
+
+    /// runs fn(iterations / threads) on every thread at once
+    void OnThreads(int threads, size_t iterations, std::function<void (size_t)> const& fn)
+    {
+        std::vector<std::thread> workers;
+        for (int i = 0; i < threads; ++i)
+            workers.emplace_back(fn, iterations / threads + 1);
+
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    // b of the logon challenge drawn on several network threads at once
+    Benchmark Random(int threads)
+    {
+        Benchmark benchmark;
+        benchmark.name = "random 152 bit (" + std::to_string(threads) + " threads)";
+
+        benchmark.check = [] ()
+        {
+            for (int bits = 1; bits <= 1100; ++bits)
+            {
+                BigNumber number;
+                number.SetRand(bits);
+                if (BN_num_bits(number.BN()) != bits || !BN_is_odd(number.BN()))
+                    return false;
+            }
+
+            // no two draws of the same thread or of different threads may repeat
+            std::vector<std::vector<std::string>> draws(4);
+            std::vector<std::thread> workers;
+            for (auto& thread : draws)
+                workers.emplace_back([&thread] ()
+                {
+                    for (int i = 0; i < 256; ++i)
+                    {
+                        BigNumber number;
+                        number.SetRand(19 * 8);
+                        uint8 bytes[19];
+                        number.WriteBytes(bytes, sizeof(bytes));
+                        thread.push_back(std::string(bytes, bytes + sizeof(bytes)));
+                    }
+                });
+
+            for (auto& worker : workers)
+                worker.join();
+
+            std::vector<std::string> all;
+            for (auto const& thread : draws)
+                all.insert(all.end(), thread.begin(), thread.end());
+
+            std::sort(all.begin(), all.end());
+            return std::adjacent_find(all.begin(), all.end()) == all.end();
+        };
+
+        benchmark.reference = [threads] (size_t iterations)
+        {
+            OnThreads(threads, iterations, [] (size_t count)
+            {
+                BIGNUM* bn = BN_new();
+                for (size_t i = 0; i < count; ++i)
+                    BN_rand(bn, 19 * 8, 0, 1);
+                BN_free(bn);
+            });
+        };
+
+        benchmark.optimized = [threads] (size_t iterations)
+        {
+            OnThreads(threads, iterations, [] (size_t count)
+            {
+                BigNumber number;
+                for (size_t i = 0; i < count; ++i)
+                    number.SetRand(19 * 8);
+            });
+        };
+
+        return benchmark;
+    }
+
+    bool SameRow(QueryResult* left, QueryResult* right)
+    {
+        if (!left || !right)
+            return left == right;
+
+        if (left->GetFieldCount() != right->GetFieldCount())
+            return false;
+
+        for (uint32 i = 0; i < left->GetFieldCount(); ++i)
+            if (left->Fetch()[i].IsNULL() != right->Fetch()[i].IsNULL() || left->Fetch()[i].GetCppString() != right->Fetch()[i].GetCppString())
+                return false;
+
+        return true;
+    }
+
+    // realms of every kind: locked for some accounts, showing their build, supporting the client or not
+    RealmMap Realms(size_t count)
+    {
+        RealmMap realms;
+        for (size_t i = 0; i < count; ++i)
+        {
+            Realm& realm = realms["Realm " + std::to_string(i)];
+            realm.address = "192.168.1." + std::to_string(i) + ":8085";
+            realm.icon = uint8(i % 4);
+            realm.realmflags = RealmFlags(i % 3 == 0 ? REALM_FLAG_SPECIFYBUILD : (i % 3 == 1 ? REALM_FLAG_RECOMMENDED : REALM_FLAG_NONE));
+            realm.timezone = uint8(1 + i % 8);
+            realm.m_ID = uint32(i + 1);
+            realm.allowedSecurityLevel = AccountTypes(i % 4);
+            realm.populationLevel = float(i % 3);
+            realm.realmbuilds.insert(i % 5 ? 12340 : 5875);
+            realm.realmBuildInfo = *FindBuildInfo(i % 5 ? 12340 : 5875);
+        }
+        return realms;
+    }
+
+    CharacterCounts Characters(size_t realms, size_t seed)
+    {
+        CharacterCounts characters;
+        for (size_t i = seed % 3; i < realms; i += 3)
+            characters.Set(uint32(i + 1), uint8(1 + (i + seed) % 10));
+        return characters;
+    }
+
+    // realm list answer, rendered field by field against the rendered packet with the account written in
+    Benchmark RealmListAnswer(uint16 build)
+    {
+        const size_t realmCount = 30;
+        auto realms = std::make_shared<RealmMap>(Realms(realmCount));
+        auto packet = std::make_shared<RealmListPacket>(*realms, build);
+        auto characters = std::make_shared<std::vector<CharacterCounts>>();
+        for (size_t seed = 0; seed < 8; ++seed)
+            characters->push_back(Characters(realmCount, seed));
+
+        Benchmark benchmark;
+        benchmark.name = build == 5875 ? "realm list 1.12.1 (30 realms)" : "realm list 3.3.5a (30 realms)";
+
+        benchmark.check = [realms, packet, characters, build] ()
+        {
+            for (auto const& counts : *characters)
+            {
+                for (int security = SEC_PLAYER; security <= SEC_CONSOLE; ++security)
+                {
+                    ByteBuffer expected;
+                    RealmListPacket::Render(expected, *realms, build, counts, AccountTypes(security));
+
+                    std::vector<uint8> result;
+                    packet->Write(result, counts, AccountTypes(security));
+                    if (result.size() != expected.size() || memcmp(result.data(), expected.contents(), result.size()))
+                        return false;
+                }
+            }
+            return true;
+        };
+
+        benchmark.reference = [realms, characters, build] (size_t iterations)
+        {
+            for (size_t i = 0; i < iterations; ++i)
+            {
+                ByteBuffer pkt;
+                RealmListPacket::Render(pkt, *realms, build, (*characters)[i % characters->size()], AccountTypes(i % 4));
+                Consume(pkt.contents()[pkt.size() - 1]);
+            }
+        };
+
+        benchmark.optimized = [packet, characters] (size_t iterations)
+        {
+            for (size_t i = 0; i < iterations; ++i)
+            {
+                std::vector<uint8> bytes;
+                packet->Write(bytes, (*characters)[i % characters->size()], AccountTypes(i % 4));
+                Consume(bytes.back());
+            }
+        };
+
+        return benchmark;
+    }
+
+    // counts the connections handed to the workers and drops them at once, nothing is read
+    class AcceptSocket : public MaNGOS::Socket
+    {
+        public:
+            static std::atomic<uint64> s_accepted;
+
+            AcceptSocket(boost::asio::io_service& service, std::function<void (Socket*)> closeHandler, MaNGOS::PacketBufferPool& bufferPool, MaNGOS::TimingWheel& timingWheel)
+                : Socket(service, closeHandler, bufferPool, timingWheel) {}
+
+            bool Open() override
+            {
+                ++s_accepted;
+                Close();
+                return true;
+            }
+
+        protected:
+            bool ProcessIncomingData() override { return false; }
+    };
+
+    std::atomic<uint64> AcceptSocket::s_accepted(0);
+
+    // a port nothing listens on, the listener binds it again right after
+    int FreePort()
+    {
+        boost::asio::io_service service;
+        boost::asio::ip::tcp::acceptor probe(service, boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        return probe.local_endpoint().port();
+    }
+
+    // opens and resets connections from a few client threads, true once the listener has accepted them all
+    bool Connect(int port, size_t connections)
+    {
+        const int clients = 8;
+        const uint64 target = AcceptSocket::s_accepted + connections;
+        const boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), port);
+
+        std::vector<std::thread> workers;
+        for (int i = 0; i < clients; ++i)
+            workers.emplace_back([&endpoint, connections, clients, i] ()
+            {
+                boost::asio::io_service service;
+                for (size_t n = i; n < connections; n += clients)
+                {
+                    boost::asio::ip::tcp::socket socket(service);
+                    boost::system::error_code ec;
+                    socket.connect(endpoint, ec);
+                    if (ec)
+                        continue;
+
+                    // wait for the worker to drop it, a connection reset before its accept completes is never handed over.
+                    // the reset then leaves no TIME_WAIT behind, the local ports would run out otherwise
+                    char byte;
+                    socket.read_some(boost::asio::buffer(&byte, 1), ec);
+                    socket.set_option(boost::asio::socket_base::linger(true, 0), ec);
+                    socket.close(ec);
+                }
+            });
+
+        for (auto& worker : workers)
+            worker.join();
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (AcceptSocket::s_accepted < target)
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+                return false;
+            std::this_thread::yield();
+        }
+
+        return true;
+    }
+
+    // connections accepted per second by the network threads, one shared acceptor thread against
+    // one SO_REUSEPORT acceptor per thread (NetworkReusePort).  Starting the listener is timed too
+    Benchmark Accept(int threads)
+    {
+        Benchmark benchmark;
+        benchmark.name = "accept (" + std::to_string(threads) + " network threads)";
+
+        benchmark.check = [threads] ()
+        {
+            const int port = FreePort();
+            MaNGOS::Listener<AcceptSocket> listener("127.0.0.1", port, threads, false, true);
+            if (!listener.IsReusePort())
+                printf("%-32s SO_REUSEPORT is not available, both columns use the shared acceptor\n", ("accept (" + std::to_string(threads) + " network threads)").c_str());
+            return Connect(port, 64);
+        };
+
+        benchmark.reference = [threads] (size_t iterations)
+        {
+            const int port = FreePort();
+            MaNGOS::Listener<AcceptSocket> listener("127.0.0.1", port, threads, false, false);
+            Connect(port, iterations);
+        };
+
+        benchmark.optimized = [threads] (size_t iterations)
+        {
+            const int port = FreePort();
+            MaNGOS::Listener<AcceptSocket> listener("127.0.0.1", port, threads, false, true);
+            Connect(port, iterations);
+        };
+
+        return benchmark;
+    }
+
+    // account lookup of the logon challenge, escaped text query against the prepared statement
+    Benchmark AccountLookup(Database* database, std::string const& account)
+    {
+        static SqlStatementID selectAccount;
+        const char* const columns = "ShaPassHash,Id,Locked,LastIp,SecurityLevel,V,S,Token,Suspended";
+
+        auto plain = [database, account, columns] () -> QueryResult*
+        {
+            std::string safeAccount = account;
+            database->escape_string(safeAccount);
+            return database->PQuery("SELECT %s FROM users_account WHERE UserName = '%s'", columns, safeAccount.c_str());
+        };
+
+        auto prepared = [database, account, columns] () -> QueryResult*
+        {
+            SqlStatement stmt = database->CreateStatement(selectAccount, (std::string("SELECT ") + columns + " FROM users_account WHERE UserName = ?").c_str());
+            return stmt.PQuery(account.c_str());
+        };
+
+        Benchmark benchmark;
+        benchmark.name = "account lookup (database)";
+
+        benchmark.check = [plain, prepared] ()
+        {
+            std::unique_ptr<QueryResult> expected(plain());
+            std::unique_ptr<QueryResult> result(prepared());
+            return SameRow(expected.get(), result.get());
+        };
+
+        benchmark.reference = [plain] (size_t iterations)
+        {
+            for (size_t i = 0; i < iterations; ++i)
+                delete plain();
+        };
+
+        benchmark.optimized = [prepared] (size_t iterations)
+        {
+            for (size_t i = 0; i < iterations; ++i)
+                delete prepared();
+        };
+
+        return benchmark;
+    }
+
+    // account and account ban of the logon challenge, two prepared statements against one multi-statement query
+    Benchmark ChallengeLookup(Database* database, std::string const& account)
+    {
+        static SqlStatementID selectAccount;
+        static SqlStatementID selectAccountBan;
+
+        // account id and ban as strings, "-" for missing rows
+        auto separate = [database, account] () -> std::string
+        {
+            SqlStatement details = database->CreateStatement(selectAccount, "SELECT ShaPassHash,Id,Locked,LastIp,SecurityLevel,V,S,Token,Suspended FROM users_account WHERE UserName = ?");
+            std::unique_ptr<QueryResult> accountResult(details.PQuery(account.c_str()));
+
+            SqlStatement ban = database->CreateStatement(selectAccountBan, "SELECT ab.unbandate FROM banned_account ab JOIN users_account a ON a.Id = ab.id "
+                                                         "WHERE a.UserName = ? AND ab.unbandate > UNIX_TIMESTAMP() ORDER BY ab.unbandate DESC LIMIT 1");
+            std::unique_ptr<QueryResult> banResult(ban.PQuery(account.c_str()));
+
+            return (accountResult ? accountResult->Fetch()[1].GetCppString() : "-") + (banResult ? banResult->Fetch()[0].GetCppString() : "-");
+        };
+
+        auto combined = [database, account] () -> std::string
+        {
+            std::string safeAccount = account;
+            database->escape_string(safeAccount);
+
+            QueryResultList results;
+            if (!database->QueryMulti(("SELECT ShaPassHash,Id,Locked,LastIp,SecurityLevel,V,S,Token,Suspended FROM users_account WHERE UserName = '" + safeAccount + "';"
+                                       "SELECT ab.unbandate FROM banned_account ab JOIN users_account a ON a.Id = ab.id "
+                                       "WHERE a.UserName = '" + safeAccount + "' AND ab.unbandate > UNIX_TIMESTAMP() ORDER BY ab.unbandate DESC LIMIT 1").c_str(), results))
+                return "error";
+
+            std::string const lookup = (results[0] ? results[0]->Fetch()[1].GetCppString() : "-") + (results[1] ? results[1]->Fetch()[0].GetCppString() : "-");
+            for (QueryResult* result : results)
+                delete result;
+            return lookup;
+        };
+
+        Benchmark benchmark;
+        benchmark.name = "challenge lookup (database)";
+
+        benchmark.check = [separate, combined] ()
+        {
+            return separate() == combined();
+        };
+
+        benchmark.reference = [separate] (size_t iterations)
+        {
+            for (size_t i = 0; i < iterations; ++i)
+                separate();
+        };
+
+        benchmark.optimized = [combined] (size_t iterations)
+        {
+            for (size_t i = 0; i < iterations; ++i)
+                combined();
+        };
+
+        return benchmark;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    namespace po = boost::program_options;
+
+    size_t iterations;
+    std::string filter;
+    std::string databaseInfo;
+    std::string account;
+
+    po::options_description desc("Usage: auth_bench [options]");
+    desc.add_options()
+        ("help,h", "print usage message")
+        ("iterations,n", po::value<size_t>(&iterations)->default_value(20000), "calls timed per benchmark")
+        ("filter,f", po::value<std::string>(&filter)->default_value(""), "only run benchmarks whose name contains this")
+        ("database,d", po::value<std::string>(&databaseInfo), "\"host;port;user;password;database\" of a login database, adds the database benchmarks")
+        ("account,a", po::value<std::string>(&account)->default_value("ADMINISTRATOR"), "user name looked up by the database benchmarks");
+
+    po::variables_map vm;
+
+    try
+    {
+        po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+        po::notify(vm);
+    }
+    catch (std::exception const& e)
+    {
+        std::cerr << e.what() << "\n" << desc << "\n";
+        return 1;
+    }
+
+    if (vm.count("help") || !iterations)
+    {
+        std::cout << desc << "\n";
+        return vm.count("help") ? 0 : 1;
+    }
+
+    // built outside of the timings
+    sSRP6Params;
+
+    std::vector<Benchmark> benchmarks;
+    benchmarks.push_back(ModExpG(152));
+    benchmarks.push_back(ModExpG(160));
+    benchmarks.push_back(ProofS());
+
+    benchmarks.push_back(Sha1(16));
+    benchmarks.push_back(Sha1(92));
+    benchmarks.push_back(Sha1(176));
+
+    const int hardwareThreads = std::thread::hardware_concurrency();
+    for (int threads = 1; threads <= 8; threads *= 2)
+        benchmarks.push_back(Random(threads));
+    if (hardwareThreads > 8)
+        benchmarks.push_back(Random(hardwareThreads));
+    benchmarks.push_back(HexSessionKey());
+    benchmarks.push_back(RealmListAnswer(5875));
+    benchmarks.push_back(RealmListAnswer(12340));
+    for (int threads : { 1, 4, 16 })
+        benchmarks.push_back(Accept(threads));
+
+    DatabaseType database;
+    if (!databaseInfo.empty())
+    {
+        if (!database.Initialize(databaseInfo.c_str()))
+        {
+            std::cerr << "cannot connect to the login database\n";
+            return 1;
+        }
+
+        benchmarks.push_back(AccountLookup(&database, account));
+        benchmarks.push_back(ChallengeLookup(&database, account));
+    }
+
+    int failed = 0;
+
+    printf("%-32s %14s %14s %9s %14s\n", "benchmark", "reference ns", "optimized ns", "speedup", "optimized /s");
+    for (auto const& benchmark : benchmarks)
+    {
+        if (!filter.empty() && benchmark.name.find(filter) == std::string::npos)
+            continue;
+
+        if (!benchmark.check())
+        {
+            printf("%-32s results differ from the reference\n", benchmark.name.c_str());
+            ++failed;
+            continue;
+        }
+
+        const double reference = NanosecondsPerCall(benchmark.reference, iterations);
+        const double optimized = NanosecondsPerCall(benchmark.optimized, iterations);
+
+        printf("%-32s %14.0f %14.0f %8.2fx %14.0f\n", benchmark.name.c_str(), reference, optimized, reference / optimized, 1e9 / optimized);
+    }
+
+    if (!databaseInfo.empty())
+        database.HaltDelayThread();
+
+    return failed ? 1 : 0;
+}
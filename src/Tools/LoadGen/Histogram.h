@@ -0,0 +1,105 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _LOADGEN_HISTOGRAM_H
+#define _LOADGEN_HISTOGRAM_H
+
+#include "Platform/Define.h"
+
+#include <atomic>
+
+/// Lock free latency histogram.  Values below 32 are exact, above that every power of two
+/// is split into 32 linear buckets, which keeps the error of a percentile around 3%.
+class Histogram
+{
+    private:
+        static const int SubBuckets = 32;
+        static const int SubBucketBits = 5;
+        static const int BucketCount = SubBuckets + (64 - SubBucketBits) * SubBuckets;
+
+        std::atomic<uint64> m_buckets[BucketCount];
+        std::atomic<uint64> m_count;
+        std::atomic<uint64> m_max;
+
+        static int BucketOf(uint64 value)
+        {
+            if (value < SubBuckets)
+                return int(value);
+
+            int exponent = 63;
+            while (!(value >> exponent))
+                --exponent;
+
+            const int sub = int(value >> (exponent - SubBucketBits)) & (SubBuckets - 1);
+            return SubBuckets + (exponent - SubBucketBits) * SubBuckets + sub;
+        }
+
+        // the middle of the values falling into the bucket
+        static uint64 ValueOf(int bucket)
+        {
+            if (bucket < SubBuckets)
+                return uint64(bucket);
+
+            const int exponent = (bucket - SubBuckets) / SubBuckets + SubBucketBits;
+            const int sub = (bucket - SubBuckets) % SubBuckets;
+            const uint64 width = uint64(1) << (exponent - SubBucketBits);
+
+            return uint64(SubBuckets + sub) * width + width / 2;
+        }
+
+    public:
+        Histogram() : m_count(0), m_max(0)
+        {
+            for (auto& bucket : m_buckets)
+                bucket = 0;
+        }
+
+        void Record(uint64 value)
+        {
+            ++m_buckets[BucketOf(value)];
+            ++m_count;
+
+            uint64 max = m_max;
+            while (value > max && !m_max.compare_exchange_weak(max, value)) {}
+        }
+
+        uint64 Count() const { return m_count; }
+        uint64 Max() const { return m_max; }
+
+        /// value below which the given fraction (0..1) of the samples lies
+        uint64 Percentile(double fraction) const
+        {
+            const uint64 count = m_count;
+            if (!count)
+                return 0;
+
+            const uint64 rank = uint64(fraction * double(count - 1)) + 1;
+            uint64 seen = 0;
+
+            for (int i = 0; i < BucketCount; ++i)
+            {
+                seen += m_buckets[i];
+                if (seen >= rank)
+                    return ValueOf(i) < m_max ? ValueOf(i) : uint64(m_max);
+            }
+
+            return m_max;
+        }
+};
+
+#endif
@@ -0,0 +1,848 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/** \file
+    Synthetic clients running the full login sequence against an authentication server:
+    logon challenge, logon proof, realm list and (optionally) reconnect challenge and proof.
+
+    The accounts are PREFIX0 .. PREFIXn-1, all sharing one password. --print-sql prints the
+    statements creating them.
+*/
+
+#include "Common.h"
+#include "Auth/BigNumber.h"
+#include "Auth/Sha1.h"
+#include "AuthCodes.h"
+#include "AuthProtocol.h"
+#include "Histogram.h"
+
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+
+#include <openssl/sha.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    struct Options
+    {
+        std::string host;
+        uint16 port;
+        int threads;
+        int concurrency;
+        int rampRate;
+        int duration;
+        int timeout;
+        int thinkTime;
+        uint16 build;
+        double wrongPasswordRatio;
+        bool reconnect;
+        bool connectOnly;
+        std::string accountPrefix;
+        int accounts;
+        std::string password;
+    };
+
+    enum Stage
+    {
+        STAGE_CONNECT,
+        STAGE_CHALLENGE,
+        STAGE_PROOF,
+        STAGE_REALM_LIST,
+        STAGE_RECONNECT_CHALLENGE,
+        STAGE_RECONNECT_PROOF,
+        STAGE_COUNT
+    };
+
+    const char* StageNames[STAGE_COUNT] =
+    {
+        "connect", "challenge", "proof", "realmlist", "reconnect challenge", "reconnect proof"
+    };
+
+    enum Failure
+    {
+        FAILURE_CONNECT,        // connection refused or reset while connecting
+        FAILURE_TIMEOUT,        // no answer within --timeout
+        FAILURE_DISCONNECT,     // the server closed the connection
+        FAILURE_PROTOCOL,       // unexpected answer
+        FAILURE_BAD_PROOF,      // server proof did not match
+        FAILURE_COUNT
+    };
+
+    const char* FailureNames[FAILURE_COUNT] =
+    {
+        "connect failed", "timeout", "disconnected", "protocol error", "bad server proof"
+    };
+
+    struct Statistics
+    {
+        Histogram latency[STAGE_COUNT];
+
+        // result codes (AuthResult) answered by the server, per stage
+        std::atomic<uint64> results[STAGE_COUNT][256];
+        std::atomic<uint64> failures[STAGE_COUNT][FAILURE_COUNT];
+
+        std::atomic<uint64> sessions;
+        std::atomic<uint64> logins;
+        std::atomic<uint64> reconnects;
+        std::atomic<uint64> wrongPasswordRejected;
+
+        Statistics() : sessions(0), logins(0), reconnects(0), wrongPasswordRejected(0)
+        {
+            for (auto& stage : results)
+                for (auto& count : stage)
+                    count = 0;
+
+            for (auto& stage : failures)
+                for (auto& count : stage)
+                    count = 0;
+        }
+    };
+
+    Options s_options;
+    Statistics s_stats;
+    std::atomic<bool> s_running(true);
+
+    std::string ToUpper(std::string str)
+    {
+        std::transform(str.begin(), str.end(), str.begin(), [](char c) { return char(toupper(uint8(c))); });
+        return str;
+    }
+
+    std::string AccountName(int index)
+    {
+        return ToUpper(s_options.accountPrefix + std::to_string(index));
+    }
+
+    /// SHA1(USER:PASSWORD), as stored in users_account.ShaPassHash
+    std::string PasswordHash(std::string const& name, std::string const& password)
+    {
+        Sha1Hash sha;
+        sha.UpdateData(ToUpper(name) + ":" + ToUpper(password));
+        sha.Finalize();
+
+        char hex[SHA_DIGEST_LENGTH * 2 + 1];
+        for (int i = 0; i < SHA_DIGEST_LENGTH; ++i)
+            snprintf(&hex[i * 2], 3, "%02X", sha.GetDigest()[i]);
+
+        return hex;
+    }
+
+    /// One fake client, running sessions back to back until the load generator stops
+    class FakeClient : public std::enable_shared_from_this<FakeClient>
+    {
+        private:
+            typedef void (FakeClient::*Continuation)();
+
+            boost::asio::io_service& m_service;
+            boost::asio::io_service::strand m_strand;
+            boost::asio::ip::tcp::socket m_socket;
+            boost::asio::deadline_timer m_timer;
+            boost::asio::ip::tcp::endpoint m_endpoint;
+
+            std::mt19937 m_random;
+
+            std::string m_login;
+            std::string m_password;
+            bool m_wrongPassword;
+            uint8 m_proofError;
+
+            Stage m_stage;
+            Clock::time_point m_stageStart;
+
+            std::vector<uint8> m_in;
+            std::vector<uint8> m_out;
+
+            BigNumber m_N, m_g, m_s, m_B, m_A, m_M, m_K;
+            BigNumber m_reconnectProof;
+
+            void BeginStage(Stage stage)
+            {
+                m_stage = stage;
+                m_stageStart = Clock::now();
+
+                auto self = shared_from_this();
+                m_timer.expires_from_now(boost::posix_time::milliseconds(s_options.timeout));
+                m_timer.async_wait(m_strand.wrap([self] (boost::system::error_code const& error)
+                {
+                    if (!error)
+                        self->Fail(FAILURE_TIMEOUT);
+                }));
+            }
+
+            void EndStage()
+            {
+                s_stats.latency[m_stage].Record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - m_stageStart).count());
+            }
+
+            void Fail(Failure failure)
+            {
+                ++s_stats.failures[m_stage][failure];
+                EndSession();
+            }
+
+            void Result(uint8 code)
+            {
+                ++s_stats.results[m_stage][code];
+            }
+
+            void Send(Continuation next)
+            {
+                auto self = shared_from_this();
+                boost::asio::async_write(m_socket, boost::asio::buffer(m_out), m_strand.wrap(
+                    [self, next] (boost::system::error_code const& error, size_t)
+                {
+                    if (error)
+                    {
+                        if (error != boost::asio::error::operation_aborted)
+                            self->Fail(FAILURE_DISCONNECT);
+                        return;
+                    }
+
+                    (self.get()->*next)();
+                }));
+            }
+
+            void Receive(size_t length, Continuation next)
+            {
+                m_in.resize(length);
+
+                auto self = shared_from_this();
+                boost::asio::async_read(m_socket, boost::asio::buffer(m_in), m_strand.wrap(
+                    [self, next] (boost::system::error_code const& error, size_t)
+                {
+                    if (error)
+                    {
+                        if (error != boost::asio::error::operation_aborted)
+                            self->Fail(FAILURE_DISCONNECT);
+                        return;
+                    }
+
+                    (self.get()->*next)();
+                }));
+            }
+
+            void Connect(Stage stage, Continuation next)
+            {
+                BeginStage(STAGE_CONNECT);
+
+                auto self = shared_from_this();
+                m_socket.async_connect(m_endpoint, m_strand.wrap([self, stage, next] (boost::system::error_code const& error)
+                {
+                    if (error)
+                    {
+                        if (error != boost::asio::error::operation_aborted)
+                            self->Fail(FAILURE_CONNECT);
+                        return;
+                    }
+
+                    self->EndStage();
+
+                    boost::system::error_code ignored;
+                    self->m_socket.set_option(boost::asio::ip::tcp::no_delay(true), ignored);
+
+                    self->BeginStage(stage);
+                    (self.get()->*next)();
+                }));
+            }
+
+            void BuildChallenge(uint8 cmd)
+            {
+                m_out.assign(sizeof(sAuthLogonChallenge_C) - 1 + m_login.size(), 0);
+
+                sAuthLogonChallenge_C* ch = reinterpret_cast<sAuthLogonChallenge_C*>(&m_out[0]);
+                ch->cmd = cmd;
+                ch->error = 0x08;
+                ch->size = uint16(m_out.size() - 4);
+                memcpy(ch->gamename, "\0WoW", 4);
+                ch->version1 = 3;
+                ch->version2 = 3;
+                ch->version3 = 5;
+                ch->build = s_options.build;
+                memcpy(ch->platform, "\0x86", 4);
+                memcpy(ch->os, "\0niW", 4);
+                memcpy(ch->country, "SUne", 4);
+                ch->timezone_bias = 60;
+                ch->ip = 0x0100007F;
+                ch->I_len = uint8(m_login.size());
+                memcpy(ch->I, m_login.c_str(), m_login.size());
+            }
+
+            // logon challenge
+            void SendChallenge()
+            {
+                BuildChallenge(CMD_AUTH_LOGON_CHALLENGE);
+                Send(&FakeClient::ReceiveChallengeHeader);
+            }
+
+            void ReceiveChallengeHeader()
+            {
+                Receive(3, &FakeClient::OnChallengeHeader);
+            }
+
+            void OnChallengeHeader()
+            {
+                if (m_in[0] != CMD_AUTH_LOGON_CHALLENGE)
+                    return Fail(FAILURE_PROTOCOL);
+
+                if (m_in[2] != WOW_SUCCESS)
+                {
+                    EndStage();
+                    Result(m_in[2]);
+                    return EndSession();
+                }
+
+                // B, g, N, s, unknown and security flags
+                Receive(32 + 1 + 1 + 1 + 32 + 32 + 16 + 1, &FakeClient::OnChallenge);
+            }
+
+            void OnChallenge()
+            {
+                const uint8* data = &m_in[0];
+
+                m_B.SetBinary(data, 32);
+                data += 32;
+                if (*data++ != 1)
+                    return Fail(FAILURE_PROTOCOL);
+                m_g.SetBinary(data, 1);
+                data += 1;
+                if (*data++ != 32)
+                    return Fail(FAILURE_PROTOCOL);
+                m_N.SetBinary(data, 32);
+                data += 32;
+                m_s.SetBinary(data, 32);
+                data += 32 + 16;
+
+                // the generated accounts never use a pin or an authenticator
+                if (*data != SECURITY_FLAG_NONE)
+                    return Fail(FAILURE_PROTOCOL);
+
+                EndStage();
+                Result(WOW_SUCCESS);
+
+                BeginStage(STAGE_PROOF);
+                SendProof();
+            }
+
+            // logon proof, the client side of SRP6
+            void SendProof()
+            {
+                const std::string hash = PasswordHash(m_login, m_wrongPassword ? m_password + "X" : m_password);
+
+                uint8 digest[SHA_DIGEST_LENGTH];
+                for (int i = 0; i < SHA_DIGEST_LENGTH; ++i)
+                    digest[i] = uint8(std::stoul(hash.substr(i * 2, 2), nullptr, 16));
+
+                Sha1Hash sha;
+                sha.UpdateData(m_s.AsByteArray(), m_s.GetNumBytes());
+                sha.UpdateData(digest, SHA_DIGEST_LENGTH);
+                sha.Finalize();
+                BigNumber x;
+                x.SetBinary(sha.GetDigest(), sha.GetLength());
+
+                BigNumber a;
+                a.SetRand(19 * 8);
+                m_A = m_g.ModExp(a, m_N);
+
+                sha.Initialize();
+                sha.UpdateBigNumbers(&m_A, &m_B, nullptr);
+                sha.Finalize();
+                BigNumber u;
+                u.SetBinary(sha.GetDigest(), 20);
+
+                // S = (B - 3 * g^x) ^ (a + u * x)
+                BigNumber v = m_g.ModExp(x, m_N);
+                BigNumber base = (m_B + m_N * 3 - (v * 3) % m_N) % m_N;
+                BigNumber S = base.ModExp(a + u * x, m_N);
+
+                uint8 t[32];
+                uint8 t1[16];
+                uint8 vK[40];
+                memcpy(t, S.AsByteArray(32), 32);
+
+                for (int i = 0; i < 16; ++i)
+                    t1[i] = t[i * 2];
+                sha.Initialize();
+                sha.UpdateData(t1, 16);
+                sha.Finalize();
+                for (int i = 0; i < 20; ++i)
+                    vK[i * 2] = sha.GetDigest()[i];
+
+                for (int i = 0; i < 16; ++i)
+                    t1[i] = t[i * 2 + 1];
+                sha.Initialize();
+                sha.UpdateData(t1, 16);
+                sha.Finalize();
+                for (int i = 0; i < 20; ++i)
+                    vK[i * 2 + 1] = sha.GetDigest()[i];
+
+                m_K.SetBinary(vK, 40);
+
+                uint8 hashNg[20];
+                sha.Initialize();
+                sha.UpdateBigNumbers(&m_N, nullptr);
+                sha.Finalize();
+                memcpy(hashNg, sha.GetDigest(), 20);
+                sha.Initialize();
+                sha.UpdateBigNumbers(&m_g, nullptr);
+                sha.Finalize();
+                for (int i = 0; i < 20; ++i)
+                    hashNg[i] ^= sha.GetDigest()[i];
+                BigNumber t3;
+                t3.SetBinary(hashNg, 20);
+
+                sha.Initialize();
+                sha.UpdateData(m_login);
+                sha.Finalize();
+                uint8 t4[SHA_DIGEST_LENGTH];
+                memcpy(t4, sha.GetDigest(), SHA_DIGEST_LENGTH);
+
+                sha.Initialize();
+                sha.UpdateBigNumbers(&t3, nullptr);
+                sha.UpdateData(t4, SHA_DIGEST_LENGTH);
+                sha.UpdateBigNumbers(&m_s, &m_A, &m_B, &m_K, nullptr);
+                sha.Finalize();
+                m_M.SetBinary(sha.GetDigest(), 20);
+
+                m_out.assign(sizeof(sAuthLogonProof_C), 0);
+
+                sAuthLogonProof_C* proof = reinterpret_cast<sAuthLogonProof_C*>(&m_out[0]);
+                proof->cmd = CMD_AUTH_LOGON_PROOF;
+                memcpy(proof->A, m_A.AsByteArray(32), 32);
+                memcpy(proof->M1, sha.GetDigest(), 20);
+                proof->number_of_keys = 0;
+                proof->securityFlags = SECURITY_FLAG_NONE;
+
+                Send(&FakeClient::ReceiveProofHeader);
+            }
+
+            bool IsOldBuild() const { return s_options.build <= 6141; }
+
+            void ReceiveProofHeader()
+            {
+                Receive(2, &FakeClient::OnProofHeader);
+            }
+
+            void OnProofHeader()
+            {
+                if (m_in[0] != CMD_AUTH_LOGON_PROOF)
+                    return Fail(FAILURE_PROTOCOL);
+
+                if (m_in[1] != WOW_SUCCESS)
+                {
+                    m_proofError = m_in[1];
+
+                    // builds after 1.12.2 get two more bytes with an error
+                    if (s_options.build > 6005)
+                        return Receive(2, &FakeClient::OnProofError);
+
+                    return OnProofError();
+                }
+
+                Receive(IsOldBuild() ? sizeof(sAuthLogonProof_S_BUILD_6005) - 2 : sizeof(sAuthLogonProof_S) - 2, &FakeClient::OnProof);
+            }
+
+            void OnProofError()
+            {
+                EndStage();
+                Result(m_proofError);
+
+                if (m_wrongPassword && m_proofError == WOW_FAIL_UNKNOWN_ACCOUNT)
+                    ++s_stats.wrongPasswordRejected;
+
+                EndSession();
+            }
+
+            void OnProof()
+            {
+                Sha1Hash sha;
+                sha.UpdateBigNumbers(&m_A, &m_M, &m_K, nullptr);
+                sha.Finalize();
+
+                if (memcmp(sha.GetDigest(), &m_in[0], SHA_DIGEST_LENGTH))
+                    return Fail(FAILURE_BAD_PROOF);
+
+                EndStage();
+                Result(WOW_SUCCESS);
+                ++s_stats.logins;
+
+                BeginStage(STAGE_REALM_LIST);
+                SendRealmList();
+            }
+
+            // realm list
+            void SendRealmList()
+            {
+                m_out.assign(5, 0);
+                m_out[0] = CMD_REALM_LIST;
+
+                Send(&FakeClient::ReceiveRealmListHeader);
+            }
+
+            void ReceiveRealmListHeader()
+            {
+                Receive(3, &FakeClient::OnRealmListHeader);
+            }
+
+            void OnRealmListHeader()
+            {
+                if (m_in[0] != CMD_REALM_LIST)
+                    return Fail(FAILURE_PROTOCOL);
+
+                const size_t size = m_in[1] | (m_in[2] << 8);
+                if (!size)
+                    return OnRealmList();
+
+                Receive(size, &FakeClient::OnRealmList);
+            }
+
+            void OnRealmList()
+            {
+                EndStage();
+                Result(WOW_SUCCESS);
+
+                if (!s_options.reconnect)
+                    return EndSession();
+
+                // a new connection resuming the session, as the client does after leaving the world server
+                boost::system::error_code ignored;
+                m_socket.close(ignored);
+
+                Connect(STAGE_RECONNECT_CHALLENGE, &FakeClient::SendReconnectChallenge);
+            }
+
+            // reconnect challenge and proof
+            void SendReconnectChallenge()
+            {
+                BuildChallenge(CMD_AUTH_RECONNECT_CHALLENGE);
+                Send(&FakeClient::ReceiveReconnectChallengeHeader);
+            }
+
+            void ReceiveReconnectChallengeHeader()
+            {
+                Receive(2, &FakeClient::OnReconnectChallengeHeader);
+            }
+
+            void OnReconnectChallengeHeader()
+            {
+                if (m_in[0] != CMD_AUTH_RECONNECT_CHALLENGE)
+                    return Fail(FAILURE_PROTOCOL);
+
+                if (m_in[1] != WOW_SUCCESS)
+                {
+                    EndStage();
+                    Result(m_in[1]);
+                    return EndSession();
+                }
+
+                Receive(32, &FakeClient::OnReconnectChallenge);
+            }
+
+            void OnReconnectChallenge()
+            {
+                m_reconnectProof.SetBinary(&m_in[0], 16);
+
+                EndStage();
+                Result(WOW_SUCCESS);
+
+                BeginStage(STAGE_RECONNECT_PROOF);
+
+                BigNumber R1;
+                R1.SetRand(16 * 8);
+
+                Sha1Hash sha;
+                sha.UpdateData(m_login);
+                sha.UpdateBigNumbers(&R1, &m_reconnectProof, &m_K, nullptr);
+                sha.Finalize();
+
+                m_out.assign(sizeof(sAuthReconnectProof_C), 0);
+
+                sAuthReconnectProof_C* proof = reinterpret_cast<sAuthReconnectProof_C*>(&m_out[0]);
+                proof->cmd = CMD_AUTH_RECONNECT_PROOF;
+                memcpy(proof->R1, R1.AsByteArray(16), 16);
+                memcpy(proof->R2, sha.GetDigest(), SHA_DIGEST_LENGTH);
+                proof->number_of_keys = 0;
+
+                Send(&FakeClient::ReceiveReconnectProof);
+            }
+
+            void ReceiveReconnectProof()
+            {
+                Receive(4, &FakeClient::OnReconnectProof);
+            }
+
+            void OnReconnectProof()
+            {
+                if (m_in[0] != CMD_AUTH_RECONNECT_PROOF)
+                    return Fail(FAILURE_PROTOCOL);
+
+                EndStage();
+                Result(m_in[1]);
+
+                if (m_in[1] == WOW_SUCCESS)
+                    ++s_stats.reconnects;
+
+                EndSession();
+            }
+
+            // connect only mode, measures accept throughput
+            void OnConnectOnly()
+            {
+                EndSession();
+            }
+
+            void EndSession()
+            {
+                boost::system::error_code ignored;
+                m_timer.cancel(ignored);
+                m_socket.close(ignored);
+
+                ++s_stats.sessions;
+
+                if (!s_running)
+                    return;
+
+                if (!s_options.thinkTime)
+                {
+                    auto self = shared_from_this();
+                    m_service.post(m_strand.wrap([self] () { self->StartSession(); }));
+                    return;
+                }
+
+                auto self = shared_from_this();
+                m_timer.expires_from_now(boost::posix_time::milliseconds(s_options.thinkTime));
+                m_timer.async_wait(m_strand.wrap([self] (boost::system::error_code const& error)
+                {
+                    if (!error)
+                        self->StartSession();
+                }));
+            }
+
+        public:
+            FakeClient(boost::asio::io_service& service, boost::asio::ip::tcp::endpoint const& endpoint, int index)
+                : m_service(service), m_strand(service), m_socket(service), m_timer(service), m_endpoint(endpoint),
+                  m_random(std::random_device()() + index), m_login(AccountName(index % s_options.accounts)), m_password(s_options.password),
+                  m_wrongPassword(false), m_proofError(0), m_stage(STAGE_CONNECT)
+            {
+            }
+
+            void StartSession()
+            {
+                if (!s_running)
+                    return;
+
+                m_wrongPassword = std::uniform_real_distribution<double>(0.0, 1.0)(m_random) < s_options.wrongPasswordRatio;
+
+                if (s_options.connectOnly)
+                    Connect(STAGE_CONNECT, &FakeClient::OnConnectOnly);
+                else
+                    Connect(STAGE_CHALLENGE, &FakeClient::SendChallenge);
+            }
+
+            void Stop()
+            {
+                auto self = shared_from_this();
+                m_strand.dispatch([self] ()
+                {
+                    boost::system::error_code ignored;
+                    self->m_timer.cancel(ignored);
+                    self->m_socket.close(ignored);
+                });
+            }
+    };
+
+    void PrintReport(double seconds)
+    {
+        printf("\n");
+        printf("duration            : %.1f s\n", seconds);
+        printf("sessions            : " UI64FMTD "\n", uint64(s_stats.sessions));
+        printf("logins              : " UI64FMTD " (%.1f/s)\n", uint64(s_stats.logins), s_stats.logins / seconds);
+        if (s_options.reconnect)
+            printf("reconnects          : " UI64FMTD " (%.1f/s)\n", uint64(s_stats.reconnects), s_stats.reconnects / seconds);
+        if (s_options.wrongPasswordRatio > 0.0)
+            printf("wrong pass rejected : " UI64FMTD "\n", uint64(s_stats.wrongPasswordRejected));
+
+        printf("\n%-20s %10s %10s %10s %10s %10s   (microseconds)\n", "stage", "count", "p50", "p99", "p999", "max");
+        for (int stage = 0; stage < STAGE_COUNT; ++stage)
+        {
+            Histogram const& latency = s_stats.latency[stage];
+            if (!latency.Count())
+                continue;
+
+            printf("%-20s %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n", StageNames[stage], latency.Count(),
+                   latency.Percentile(0.5), latency.Percentile(0.99), latency.Percentile(0.999), latency.Max());
+        }
+
+        printf("\nresults and errors:\n");
+        for (int stage = 0; stage < STAGE_COUNT; ++stage)
+        {
+            for (int code = 0; code < 256; ++code)
+                if (uint64 count = s_stats.results[stage][code])
+                    printf("  %-20s result 0x%02X : " UI64FMTD "\n", StageNames[stage], code, count);
+
+            for (int failure = 0; failure < FAILURE_COUNT; ++failure)
+                if (uint64 count = s_stats.failures[stage][failure])
+                    printf("  %-20s %-11s : " UI64FMTD "\n", StageNames[stage], FailureNames[failure], count);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    namespace po = boost::program_options;
+
+    po::options_description desc("Usage: auth_loadgen [options]");
+    desc.add_options()
+        ("help,h", "print usage message")
+        ("host", po::value<std::string>(&s_options.host)->default_value("127.0.0.1"), "authentication server address")
+        ("port", po::value<uint16>(&s_options.port)->default_value(3724), "authentication server port")
+        ("threads", po::value<int>(&s_options.threads)->default_value(int(std::max(1u, std::thread::hardware_concurrency()))), "client threads")
+        ("concurrency,c", po::value<int>(&s_options.concurrency)->default_value(100), "simultaneous clients")
+        ("ramp", po::value<int>(&s_options.rampRate)->default_value(0), "clients started per second, 0 starts all at once")
+        ("duration,d", po::value<int>(&s_options.duration)->default_value(30), "test duration in seconds")
+        ("timeout", po::value<int>(&s_options.timeout)->default_value(10000), "timeout of a single stage in milliseconds")
+        ("think", po::value<int>(&s_options.thinkTime)->default_value(0), "pause between two sessions of a client in milliseconds")
+        ("build", po::value<uint16>(&s_options.build)->default_value(12340), "client build sent in the challenge")
+        ("wrong-password", po::value<double>(&s_options.wrongPasswordRatio)->default_value(0.0), "fraction of sessions using a wrong password (0..1)")
+        ("reconnect", po::bool_switch(&s_options.reconnect), "run a reconnect challenge and proof after each realm list")
+        ("connect-only", po::bool_switch(&s_options.connectOnly), "only connect and disconnect, measures accept throughput")
+        ("account-prefix", po::value<std::string>(&s_options.accountPrefix)->default_value("LOADGEN"), "account names are <prefix><n>")
+        ("accounts", po::value<int>(&s_options.accounts)->default_value(1000), "number of accounts, client n uses account n modulo this")
+        ("password", po::value<std::string>(&s_options.password)->default_value("loadgen"), "password of all accounts")
+        ("print-sql", "print the statements creating the accounts and exit");
+
+    po::variables_map vm;
+
+    try
+    {
+        po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+        po::notify(vm);
+    }
+    catch (std::exception const& e)
+    {
+        std::cerr << e.what() << "\n" << desc << "\n";
+        return 1;
+    }
+
+    if (vm.count("help"))
+    {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    if (s_options.accounts <= 0 || s_options.concurrency <= 0 || s_options.threads <= 0)
+    {
+        std::cerr << "accounts, concurrency and threads must be positive\n";
+        return 1;
+    }
+
+    if (vm.count("print-sql"))
+    {
+        for (int i = 0; i < s_options.accounts; ++i)
+            printf("INSERT INTO users_account (UserName, ShaPassHash) VALUES ('%s', '%s');\n",
+                   AccountName(i).c_str(), PasswordHash(AccountName(i), s_options.password).c_str());
+        return 0;
+    }
+
+    if (s_options.concurrency > s_options.accounts && s_options.reconnect)
+        std::cerr << "warning: clients sharing an account overwrite each other's session key, reconnects may fail\n";
+
+    boost::asio::io_service service;
+    std::unique_ptr<boost::asio::io_service::work> work(new boost::asio::io_service::work(service));
+
+    boost::asio::ip::tcp::endpoint endpoint;
+
+    try
+    {
+        endpoint = boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string(s_options.host), s_options.port);
+    }
+    catch (std::exception const& e)
+    {
+        std::cerr << "invalid host " << s_options.host << ": " << e.what() << "\n";
+        return 1;
+    }
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < s_options.threads; ++i)
+        threads.push_back(std::thread([&service] () { service.run(); }));
+
+    std::vector<std::shared_ptr<FakeClient>> clients;
+    clients.reserve(s_options.concurrency);
+
+    const auto start = Clock::now();
+    const auto end = start + std::chrono::seconds(s_options.duration);
+    auto nextReport = start + std::chrono::seconds(1);
+    uint64 lastLogins = 0;
+
+    while (Clock::now() < end)
+    {
+        // start clients following the ramp
+        const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        const size_t target = s_options.rampRate > 0 ? std::min<size_t>(s_options.concurrency, size_t(elapsed * s_options.rampRate) + 1) : s_options.concurrency;
+
+        while (clients.size() < target)
+        {
+            clients.push_back(std::make_shared<FakeClient>(service, endpoint, int(clients.size())));
+            clients.back()->StartSession();
+        }
+
+        if (Clock::now() >= nextReport)
+        {
+            const uint64 logins = s_stats.logins;
+            printf("%4d s: %zu clients, " UI64FMTD " logins/s, " UI64FMTD " sessions\n", int(elapsed + 0.5), clients.size(), logins - lastLogins, uint64(s_stats.sessions));
+            fflush(stdout);
+
+            lastLogins = logins;
+            nextReport += std::chrono::seconds(1);
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    s_running = false;
+
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    for (auto const& client : clients)
+        client->Stop();
+
+    work.reset();
+    service.stop();
+
+    for (auto& thread : threads)
+        thread.join();
+
+    PrintReport(seconds);
+
+    return 0;
+}
@@ -0,0 +1,294 @@
+/*
+ * This file is part of the CMaNGOS Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/** \file
+    Offline creation of the SRP6 verifier (V) and salt (S) of every account which has none yet,
+    so that no login has to compute and store them.
+
+    Accounts are read in pages ordered by Id, the verifiers of a page are computed on all
+    threads and written back as multi-row updates, one transaction per page, while the next
+    page is read and computed. Accounts given a verifier by a login in the meantime are
+    left untouched.
+*/
+
+#include "Common.h"
+#include "Auth/SRP6Params.h"
+#include "Config/Config.h"
+#include "Database/DatabaseEnv.h"
+
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // same test as the logon challenge, which recreates both when either is malformed
+    const char* const MissingVerifier = "(V IS NULL OR S IS NULL OR LENGTH(V) <> 64 OR LENGTH(S) <> 64)";
+
+    struct Account
+    {
+        uint32 id;
+        std::string passHash;
+        char v[SRP6Params::NBytes * 2 + 1];
+        char s[SRP6Params::SaltBytes * 2 + 1];
+    };
+
+    typedef std::vector<Account> Page;
+
+    bool IsPassHash(std::string const& passHash)
+    {
+        return passHash.size() == 40 && std::all_of(passHash.begin(), passHash.end(), [] (char c) { return isxdigit(uint8(c)); });
+    }
+
+    /// Next accounts without verifier after lastId, accounts without usable ShaPassHash are skipped and counted
+    bool ReadPage(Database& database, uint32 lastId, uint32 size, Page& page, uint64& skipped)
+    {
+        page.clear();
+
+        QueryResult* result = database.PQuery("SELECT Id, ShaPassHash FROM users_account WHERE Id > %u AND %s ORDER BY Id LIMIT %u",
+                                              lastId, MissingVerifier, size);
+        if (!result)
+            return false;
+
+        page.reserve(result->GetRowCount());
+        do
+        {
+            Field* fields = result->Fetch();
+
+            Account account;
+            account.id = fields[0].GetUInt32();
+            account.passHash = fields[1].GetCppString();
+
+            // the last Id still moves the next page forward
+            if (!IsPassHash(account.passHash))
+            {
+                ++skipped;
+                account.passHash.clear();
+            }
+
+            page.push_back(account);
+        }
+        while (result->NextRow());
+
+        delete result;
+        return true;
+    }
+
+    void ComputePage(Page& page, int threads)
+    {
+        std::atomic<size_t> next(0);
+        auto work = [&page, &next] ()
+        {
+            BigNumber salt, verifier;
+            for (size_t i = next++; i < page.size(); i = next++)
+            {
+                Account& account = page[i];
+                if (account.passHash.empty())
+                    continue;
+
+                sSRP6Params.MakeVerifier(account.passHash, salt, verifier);
+                verifier.WriteHexStr(account.v, sizeof(account.v));
+                salt.WriteHexStr(account.s, sizeof(account.s));
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (int i = 1; i < threads; ++i)
+            workers.emplace_back(work);
+        work();
+
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    /// One UPDATE per batch rows, the whole page in one transaction
+    bool WritePage(Database& database, Page const& page, uint32 batch, uint64& written)
+    {
+        database.BeginTransaction();
+
+        uint64 rows = 0;
+        std::string values, salts, ids;
+
+        for (size_t start = 0; start < page.size(); start += batch)
+        {
+            values.clear();
+            salts.clear();
+            ids.clear();
+
+            for (size_t i = start; i < std::min(page.size(), start + batch); ++i)
+            {
+                Account const& account = page[i];
+                if (account.passHash.empty())
+                    continue;
+
+                std::string const id = std::to_string(account.id);
+                values += " WHEN " + id + " THEN '" + account.v + "'";
+                salts += " WHEN " + id + " THEN '" + account.s + "'";
+                ids += (ids.empty() ? "" : ",") + id;
+                ++rows;
+            }
+
+            if (ids.empty())
+                continue;
+
+            // hex strings only, nothing to escape
+            std::string const sql = "UPDATE users_account SET V = CASE Id" + values + " END, S = CASE Id" + salts +
+                                    " END WHERE Id IN (" + ids + ") AND " + MissingVerifier;
+            database.Execute(sql.c_str());
+        }
+
+        if (!database.CommitTransactionDirect())
+            return false;
+
+        written += rows;
+        return true;
+    }
+
+    uint64 CountMissing(Database& database)
+    {
+        uint64 count = 0;
+        if (QueryResult* result = database.PQuery("SELECT COUNT(*) FROM users_account WHERE %s", MissingVerifier))
+        {
+            count = result->Fetch()[0].GetUInt64();
+            delete result;
+        }
+        return count;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    namespace po = boost::program_options;
+
+    std::string configFile;
+    std::string databaseInfo;
+    int threads;
+    uint32 batch;
+    uint32 pageSize;
+
+    po::options_description desc("Usage: auth_verifiers [options]");
+    desc.add_options()
+        ("help,h", "print usage message")
+        ("config,c", po::value<std::string>(&configFile)->default_value("AuthServer.conf"), "configuration file of the server, provides LoginDatabaseInfo")
+        ("database,d", po::value<std::string>(&databaseInfo), "\"host;port;user;password;database\", overrides the configuration file")
+        ("threads,t", po::value<int>(&threads)->default_value(int(std::max(1u, std::thread::hardware_concurrency()))), "threads computing verifiers")
+        ("batch,b", po::value<uint32>(&batch)->default_value(500), "accounts updated by one statement")
+        ("page,p", po::value<uint32>(&pageSize)->default_value(10000), "accounts read, computed and committed at once");
+
+    po::variables_map vm;
+
+    try
+    {
+        po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+        po::notify(vm);
+    }
+    catch (std::exception const& e)
+    {
+        std::cerr << e.what() << "\n" << desc << "\n";
+        return 1;
+    }
+
+    if (vm.count("help"))
+    {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    if (threads <= 0 || !batch || !pageSize)
+    {
+        std::cerr << "threads, batch and page must be positive\n";
+        return 1;
+    }
+
+    if (!sConfig.SetSource(configFile) && databaseInfo.empty())
+    {
+        std::cerr << "could not read " << configFile << ", pass the database with --database\n";
+        return 1;
+    }
+
+    if (databaseInfo.empty())
+        databaseInfo = sConfig.GetStringDefault("LoginDatabaseInfo");
+
+    DatabaseType database;
+    if (databaseInfo.empty() || !database.Initialize(databaseInfo.c_str()))
+    {
+        std::cerr << "cannot connect to the login database\n";
+        return 1;
+    }
+
+    // built before the worker threads need it
+    sSRP6Params;
+
+    const uint64 total = CountMissing(database);
+    printf("%" PRIu64 " account(s) without verifier, %d thread(s)\n", total, threads);
+
+    const Clock::time_point start = Clock::now();
+    uint64 written = 0, skipped = 0;
+    bool failed = false;
+
+    Page page, next;
+    uint32 lastId = 0;
+
+    bool more = ReadPage(database, lastId, pageSize, page, skipped);
+    if (more)
+        ComputePage(page, threads);
+
+    while (more)
+    {
+        lastId = page.back().id;
+
+        // the next page is read and computed while this one is committed
+        bool committed = false;
+        std::thread writer([&database, &page, batch, &written, &committed] () { committed = WritePage(database, page, batch, written); });
+        more = ReadPage(database, lastId, pageSize, next, skipped);
+        if (more)
+            ComputePage(next, threads);
+        writer.join();
+
+        if (!committed)
+        {
+            std::cerr << "writing the accounts up to id " << lastId << " failed\n";
+            failed = true;
+            break;
+        }
+
+        std::swap(page, next);
+
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        const double rate = seconds > 0.0 ? written / seconds : 0.0;
+        const uint64 done = written + skipped;
+        printf("%" PRIu64 " / %" PRIu64 " (%.1f%%), %.0f accounts/s, %.0f s left\n", done, total,
+               total ? 100.0 * std::min(done, total) / total : 100.0, rate, rate > 0.0 && total > done ? (total - done) / rate : 0.0);
+        fflush(stdout);
+    }
+
+    database.HaltDelayThread();
+
+    printf("%" PRIu64 " verifier(s) written, %" PRIu64 " account(s) skipped without a valid ShaPassHash\n", written, skipped);
+    return failed ? 1 : 0;
+}